@@ -18,8 +18,291 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stddef.h>
+#include <sys/stat.h>
+
 #include <flos/utf8.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum utils_argument {
+    UTILS_NO_ARGUMENT = 0,
+    UTILS_REQUIRED_ARGUMENT,
+    UTILS_LIST_ARGUMENT,      // items split with utils_split_next(), e.g. "a,b,c"
+    UTILS_KEY_VALUE_ARGUMENT, // items split further with utils_split_pair(), e.g. "k1=v1,k2=v2"
+};
+
+/*
+ * Option table entry, as emitted by optgen from an option spec.
+ */
+struct utils_option {
+    utf8_char code;               // value returned by the parser
+    char short_name;              // '\0' when option has only a long name
+    const char *long_name;        // NULL when option has only a short name
+    enum utils_argument argument; // whether option takes an argument
+    const char *arg_name;         // argument placeholder, e.g. "FILE"
+    const char *help;             // one line description
+};
+
+/*
+ * Returns next option of argv and sets optarg to its argument, or returns 0
+ * when options are over and argv holds the operands. Opts lists option
+ * characters, ':' after one meaning it requires an argument. A leading ':'
+ * suppresses diagnostics and makes a missing argument return ':' instead of
+ * '?'; optarg then points to the option character.
+ */
 utf8_char utils_getopt(int *argc, char **argv[], char **optarg, const char *opts);
 
+enum utils_opt_kind {
+    UTILS_OPT_NONE = 0, // not an option
+    UTILS_OPT_FLAG,     // option without an argument
+    UTILS_OPT_ARGUMENT, // option with a required argument
+};
+
+/*
+ * Opts compiled into a lookup table, e.g. by flos::options at compile time,
+ * so options are not searched for in a string.
+ */
+struct utils_opts_table {
+    char ordering;            // '+', '-' or '\0', as the prefix of opts
+    char silent;              // as a leading ':' of opts
+    unsigned char kinds[128]; // enum utils_opt_kind of each ASCII character
+};
+
+/* Same as utils_getopt() with opts given as a table */
+utf8_char utils_getopt_table(int *argc, char **argv[], char **optarg, const struct utils_opts_table *table);
+
+/*
+ * Moves operands of argv[0..count) after the words following it up to NULL,
+ * keeping their order, as a permuting parser does at the first operand, and
+ * returns their number. Options are looked up in options; "--name" of one
+ * with an argument and without '=' takes the next word. For parsers generated
+ * by optgen.
+ */
+int utils_permute(int count, char *argv[], const struct utils_option *options, size_t noptions);
+
+#define UTILS_USAGE_WIDTH 80
+
+/*
+ * Writes usage line and option descriptions to fd with a single writev().
+ * Descriptions are wrapped at width columns (UTILS_USAGE_WIDTH when 0).
+ * Returns 0 on success or -1 with errno set.
+ */
+int utils_usage(int fd, const char *synopsis, const struct utils_option *options, size_t count, size_t width);
+
+struct utils_parse_option {
+    utf8_char code;     // value returned by utils_getopt()
+    const char *optarg; // its optarg
+};
+
+/*
+ * Result of parsing argv with utils_getopt(): options in the order they were
+ * returned and operands left. Strings are owned by the result.
+ */
+struct utils_parse {
+    size_t noptions;
+    const struct utils_parse_option *options;
+    size_t noperands;
+    const char *const *operands;
+};
+
+struct utils_parse_cache_stats {
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+    size_t entries;
+    size_t bytes; // memory used by entries and cache itself
+};
+
+struct utils_parse_cache;
+
+/*
+ * Creates cache of parse results holding at most max_bytes, split into shards
+ * with own locks and LRU lists. Returns NULL when out of memory.
+ */
+struct utils_parse_cache *utils_parse_cache_create(size_t max_bytes, unsigned shards);
+
+/*
+ * Frees cache and results no longer referenced. Results not released yet stay
+ * valid until utils_parse_release(), which must not run concurrently with it.
+ */
+void utils_parse_cache_destroy(struct utils_parse_cache *cache);
+
+/*
+ * Returns parse of argv with opts, running utils_getopt() on a copy only when
+ * the same opts and arguments are not cached yet, with POSIXLY_CORRECT set or
+ * unset as now; argv is not modified. The result is immutable and may be
+ * shared between threads, and must be given back with utils_parse_release().
+ * Returns NULL when out of memory.
+ */
+const struct utils_parse *utils_parse_cached(struct utils_parse_cache *cache, int argc, char *const argv[],
+                                             const char *opts);
+void utils_parse_release(const struct utils_parse *parse);
+void utils_parse_cache_get_stats(struct utils_parse_cache *cache, struct utils_parse_cache_stats *stats);
+
+enum utils_step {
+    UTILS_STEP_DONE = 0, // result is complete
+    UTILS_STEP_MORE,     // budget is spent, step again to continue
+    UTILS_STEP_ERROR,    // out of memory
+};
+
+/* Work allowed for one step; 0 means no limit */
+struct utils_budget {
+    size_t max_units;     // arguments, cluster characters and copied results
+    long max_nanoseconds; // checked every UTILS_STEP_CHECK units
+};
+
+#define UTILS_STEP_CHECK 32
+
+struct utils_parser;
+
+/*
+ * Starts parse of argv with opts in steps, for callers that must not block
+ * for long, e.g. an event loop. The result is the same as a full parse with
+ * utils_getopt(), but argv is not modified. Argv must stay valid until
+ * utils_parser_destroy(). Returns NULL when out of memory.
+ */
+struct utils_parser *utils_parser_create(int argc, char *const argv[], const char *opts);
+
+/*
+ * Continues the parse from where the last step stopped and returns
+ * UTILS_STEP_MORE while there is work left. A unit of work is a word, a
+ * character of an option cluster or an option copied into the result, and
+ * takes time independent of argc, so a step is bounded by max_units, or by
+ * max_nanoseconds plus at most UTILS_STEP_CHECK units, whichever is less.
+ * Every step does at least one unit; without any limit it runs to the end.
+ */
+enum utils_step utils_parser_step(struct utils_parser *parser, const struct utils_budget *budget);
+
+/* Returns result once a step has returned UTILS_STEP_DONE, NULL before */
+const struct utils_parse *utils_parser_result(const struct utils_parser *parser);
+void utils_parser_destroy(struct utils_parser *parser);
+
+enum utils_completion {
+    UTILS_COMPLETE_OPERAND = 0, // an operand is expected, there are no matches
+    UTILS_COMPLETE_OPTION,      // matches are options the word can be completed to
+    UTILS_COMPLETE_ARGUMENT,    // argument of the only match is expected
+};
+
+/*
+ * Tells what is expected at argv[cursor] (argv[argc] when starting a new
+ * word) without parsing or modifying argv. Words before the cursor are
+ * replayed with rules of the parser optgen generates from options, with mode
+ * '+', '-' or '\0' as its %mode, so with '\0' and POSIXLY_CORRECT set options
+ * end at the first operand. Long options are matched by prefix;
+ * for a word "--name=" the option of name is returned as argument match.
+ * On input *nmatches is capacity of matches, on output number of matches
+ * found, which may exceed the capacity. It does no allocation, so tools
+ * can answer completion queries before any other initialization.
+ */
+enum utils_completion utils_complete(int argc, char *argv[], int cursor, char mode, const struct utils_option *options,
+                                     size_t count, const struct utils_option **matches, size_t *nmatches);
+
+struct utils_glob;
+
+/*
+ * Expands operand patterns for tools started without a shell. Components may
+ * use '*', '?' and '[...]' as in fnmatch(), and "**" matches any number of
+ * directories without following symbolic links. With threads > 0 directories
+ * are read ahead by that many workers, at most a bounded number at a time.
+ * Patterns must stay valid until utils_glob_destroy(). Returns NULL when out
+ * of memory.
+ */
+struct utils_glob *utils_glob_create(size_t count, char *const patterns[], unsigned threads);
+
+/*
+ * Returns 1 and next path, valid until the next call, 0 when all patterns are
+ * expanded or -1 with errno set. Order does not depend on threads: patterns
+ * in given order, names of a directory in byte order, matches in a directory
+ * before those below it. Like sh, a pattern without special characters or
+ * without matches is returned as is.
+ */
+int utils_glob_next(struct utils_glob *glob, const char **path);
+void utils_glob_destroy(struct utils_glob *glob);
+
+#define UTILS_PREFETCH_OPEN     0x1 // open operands read-only, not only stat them
+#define UTILS_PREFETCH_IN_ORDER 0x2 // return operands in given order, not as resolved
+
+struct utils_prefetch_result {
+    size_t index;     // position in operands
+    const char *path; // operands[index]
+    int fd;           // descriptor now owned by caller, -1 without UTILS_PREFETCH_OPEN or on error
+    int error;        // errno of failed stat() or open(), 0 on success
+    struct stat st;
+};
+
+struct utils_prefetch;
+
+/*
+ * Starts resolving operands left by utils_getopt() with threads workers
+ * stat()ing or opening them concurrently, at most a bounded number ahead of
+ * the caller so a long list does not run out of descriptors. With 0 threads
+ * operands are resolved by utils_prefetch_next() itself. Operands must stay
+ * valid until utils_prefetch_destroy(). Returns NULL when out of memory.
+ */
+struct utils_prefetch *utils_prefetch_create(size_t count, char *const operands[], int flags, unsigned threads);
+
+/*
+ * Takes next resolved operand from the ready queue, waiting only when none
+ * is ready yet. Returns 1, or 0 when all operands have been returned.
+ */
+int utils_prefetch_next(struct utils_prefetch *prefetch, struct utils_prefetch_result *result);
+
+/* Stops workers and closes descriptors not returned yet */
+void utils_prefetch_destroy(struct utils_prefetch *prefetch);
+
+/* View into a string, not terminated by '\0' */
+struct utils_span {
+    const char *ptr;
+    size_t len;
+};
+
+#define UTILS_SPLIT_MAX_SET 8
+#define UTILS_SPLIT_BLOCK   16
+
+/*
+ * State of splitting a list valued option argument. Fields are private,
+ * set by utils_split_init().
+ */
+struct utils_splitter {
+    const char *next, *end;
+    const char *separators;
+    char escape;
+    char set[UTILS_SPLIT_MAX_SET]; // separators and escape, scanned for at once
+    size_t nset;                   // 0 when there are too many to scan at once
+    unsigned char repeated[UTILS_SPLIT_MAX_SET][UTILS_SPLIT_BLOCK]; // each of set filling a block
+};
+
+/*
+ * Prepares splitting value at any of separators. A separator preceded by
+ * escape ('\0' for none) is part of an item. Value is not copied or modified,
+ * so items may point into argv.
+ */
+void utils_split_init(struct utils_splitter *splitter, const char *value, const char *separators, char escape);
+
+/*
+ * Returns 1 and next item, or 0 when there are no more. Empty items are
+ * skipped, like strtok() does. Escapes are left in items, see utils_unescape().
+ */
+int utils_split_next(struct utils_splitter *splitter, struct utils_span *item);
+
+/*
+ * Splits item at the first assign not preceded by escape. Returns 1, or 0
+ * when there is none and item is all key with an empty value.
+ */
+int utils_split_pair(struct utils_span item, char assign, char escape, struct utils_span *key,
+                     struct utils_span *value);
+
+/*
+ * Copies span to out without escapes, for items that need to be a C string.
+ * Out must hold span.len + 1 bytes. Returns length of the copy.
+ */
+size_t utils_unescape(struct utils_span span, char escape, char *out);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* UTILS_H */
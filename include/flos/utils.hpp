@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTILS_HPP
+#define UTILS_HPP
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+
+#include <flos/utils.h>
+
+namespace flos {
+
+/*
+ * Option spec in utils_getopt() syntax, validated and compiled into a lookup
+ * table when constructed. Declared constexpr, an invalid spec is a compile
+ * error and the table is a constant:
+ *
+ *     constexpr flos::options spec{"+:ab:o:"};
+ *     static_assert(spec.takes_argument('o'));
+ */
+template <std::size_t N> class options {
+  public:
+    enum kind : unsigned char {
+        none = UTILS_OPT_NONE,         // not an option
+        flag = UTILS_OPT_FLAG,         // option without an argument
+        argument = UTILS_OPT_ARGUMENT, // option with a required argument
+    };
+
+    constexpr options(const char (&text)[N]) : spec_{}, table_{} {
+        std::size_t i = 0;
+
+        for (std::size_t j = 0; j < N; j++) {
+            spec_[j] = text[j];
+        }
+
+        if (text[i] == '+' || text[i] == '-') {
+            table_.ordering = text[i++];
+        }
+        if (text[i] == ':') {
+            table_.silent = 1;
+            i++;
+        }
+
+        for (; i < N - 1; i++) {
+            char c = text[i];
+
+            if (c == ':') {
+                throw std::invalid_argument("':' must follow an option character");
+            }
+            if (!is_short_name(c)) {
+                throw std::invalid_argument("option must be a letter or a digit");
+            }
+            if (table_.kinds[index(c)] != none) {
+                throw std::invalid_argument("duplicate option character");
+            }
+
+            if (text[i + 1] == ':') {
+                if (i + 2 < N - 1 && text[i + 2] == ':') {
+                    throw std::invalid_argument("optional arguments ('::') are not supported");
+                }
+                table_.kinds[index(c)] = argument;
+                i++;
+            } else {
+                table_.kinds[index(c)] = flag;
+            }
+        }
+    }
+
+    constexpr kind lookup(char c) const {
+        return is_short_name(c) ? kind(table_.kinds[index(c)]) : none;
+    }
+
+    constexpr bool has(char c) const {
+        return lookup(c) != none;
+    }
+
+    constexpr bool takes_argument(char c) const {
+        return lookup(c) == argument;
+    }
+
+    // '+' stops at first operand, '-' returns operands in order, '\0' permutes
+    constexpr char ordering() const {
+        return table_.ordering;
+    }
+
+    constexpr bool silent() const {
+        return table_.silent != 0;
+    }
+
+    constexpr const char *c_str() const {
+        return spec_.data();
+    }
+
+    // Lookup table for utils_getopt_table()
+    constexpr const utils_opts_table &table() const {
+        return table_;
+    }
+
+  private:
+    static constexpr bool is_short_name(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+    }
+
+    static constexpr std::size_t index(char c) {
+        return static_cast<unsigned char>(c) & 0x7f;
+    }
+
+    std::array<char, N> spec_;
+    utils_opts_table table_;
+};
+
+template <std::size_t N> options(const char (&)[N]) -> options<N>;
+
+/*
+ * Iterates over options with utils_getopt_table() using the table of the
+ * spec. Values are views into argv, so nothing is allocated or copied; the
+ * spec must outlive the parser.
+ *
+ *     flos::parser p(spec, argc, argv);
+ *     while (utf8_char c = p.next()) { ... p.value() ... }
+ *     for (std::size_t i = 0; i < p.operand_count(); i++) { ... p.operand(i) ... }
+ */
+class parser {
+  public:
+    template <std::size_t N>
+    parser(const options<N> &opts, int argc, char **argv) : table_(&opts.table()), argc_(argc), argv_(argv) {
+    }
+
+    // Returns next option code or 0 when options are over, see utils_getopt()
+    utf8_char next() {
+        char *optarg = nullptr;
+        utf8_char c = utils_getopt_table(&argc_, &argv_, &optarg, table_);
+
+        value_ = optarg != nullptr ? std::string_view(optarg) : std::string_view();
+
+        return c;
+    }
+
+    // optarg of the last option returned by next()
+    std::string_view value() const {
+        return value_;
+    }
+
+    // Operands left after next() has returned 0
+    std::size_t operand_count() const {
+        return argc_ > 0 ? static_cast<std::size_t>(argc_) : 0;
+    }
+
+    std::string_view operand(std::size_t i) const {
+        return argv_[i];
+    }
+
+  private:
+    const utils_opts_table *table_;
+    int argc_;
+    char **argv_;
+    std::string_view value_;
+};
+
+} // namespace flos
+
+#endif /* UTILS_HPP */
@@ -9,41 +9,89 @@ include config.mk
 #    HDRS - list of headers to install
 #    SRCS - list of source files
 #    PKGS - list of dependent libraries
+#    BINS - list of programs built from tools/
+#    OPTSPECS - list of option specs compiled by optgen
+#    TESTSRCS - list of tests run by "make tests"
+#    BENCHSRCS - list of benchmarks run by "make bench"
+#    FUZZSRCS - list of libFuzzer targets built by "make fuzz"
+#    COUNTSRCS - list of sources linked into FUZZSRCS built with UTILS_COUNT_WRITES
 #
 # Also it can modify some variables:
 #    CFLAGS - build flags for C files
+#    CXXFLAGS - build flags for C++ tests
 #
 include $(SUBDIR)/source.mk
 
 OBJS != echo $(SRCS:.c=.o) | sed -e 's/$(SUBDIR)\//$(builddir)\/$(SUBDIR)\//g'
 DEPS != echo $(SRCS:.c=.d) | sed -e 's/$(SUBDIR)\//$(builddir)\/$(SUBDIR)\//g'
 PPS != echo $(SRCS:.c=.c.pp) | sed -e 's/$(SUBDIR)\//$(builddir)\/$(SUBDIR)\//g'
-TESTS != echo $(TESTSRCS:.c=) | sed -e 's/tests\//$(builddir)\//g'
+TESTS != echo $(TESTSRCS:.c=) | sed -e 's/\.cpp//g' -e 's/tests\//$(builddir)\//g'
+BENCHES != echo $(BENCHSRCS:.c=) | sed -e 's/tests\//$(builddir)\//g'
+FUZZERS != echo $(FUZZSRCS:.c=-libfuzzer) | sed -e 's/tests\//$(builddir)\//g'
+FUZZTESTS != echo $(FUZZSRCS:.c=) | sed -e 's/tests\//$(builddir)\//g'
+COUNTOBJS != echo $(COUNTSRCS:.c=-counted.o) | sed -e 's/$(SUBDIR)\//$(builddir)\/$(SUBDIR)\//g'
+GENSRCS != echo $(OPTSPECS:.opts=.opts.c) | sed -e 's/tests\//$(builddir)\/tests\//g'
+
+OPTGEN = bin/optgen
 
 .SUFFIXES:
-.PHONY: all tests clean
+.PHONY: all tests bench fuzz clean
+.SECONDARY: $(GENSRCS)
 
-all: $(LIB)
+all: $(LIB) $(BINS)
 
 $(LIB): $(OBJS)
 	mkdir -p lib
 	rm -f $@
 	$(AR) -rcs $@ $^
 
+# Objects counting their work, linked before $(LIB) so its own are not pulled in
+$(builddir)/%-counted.o: %.c
+	@mkdir -p $(@D)
+	$(CC) $(CFLAGS) -DUTILS_COUNT_WRITES -c -o $@ $<
+
 $(builddir)/%.o: %.c
 	@mkdir -p $(@D)
 	$(PP) $(CFLAGS) $< > $(builddir)/$*.c.pp
 	$(CC) $(CFLAGS) -MMD -MF $(builddir)/$*.d -c -o $@ $<
 
+bin/%: tools/%.c $(LIB)
+	@mkdir -p $(@D) $(builddir)/tools
+	$(CC) $(CFLAGS) -MMD -MF $(builddir)/tools/$*.d -o $@ $^
+
+# Generated parsers are included by tests, so they are not linked separately
+$(builddir)/tests/%.opts.c: tests/%.opts $(OPTGEN)
+	@mkdir -p $(@D)
+	$(OPTGEN) -o $@ -H $(builddir)/tests/$*.opts.h $<
+
 tests: $(TESTS) $(LIB)
 	$(PROVE) $(PROVE_FLAGS) $(TESTS)
 
-$(builddir)/%: tests/%.c $(LIB)
+bench: $(BENCHES) $(LIB)
+	for b in $(BENCHES); do echo "# $$b"; $$b || exit 1; done
+
+# Fuzz targets need a compiler with libFuzzer, e.g. "make fuzz FUZZCC=clang"
+fuzz: $(FUZZERS)
+
+$(builddir)/%-libfuzzer: tests/%.c $(COUNTOBJS) $(LIB)
+	@mkdir -p $(@D)
+	$(FUZZCC) $(CFLAGS) -DFUZZING -fsanitize=fuzzer,address -o $@ $^
+
+$(FUZZTESTS): $(builddir)/%: tests/%.c $(COUNTOBJS) $(LIB)
 	@mkdir -p $(builddir)/$(*D)
 	$(PP) $(CFLAGS) $< > $(builddir)/$*.c.pp
 	$(CC) $(CFLAGS) -MMD -MF $(builddir)/$*.d -o $@ $^
 
+$(builddir)/%: tests/%.c $(LIB) | $(GENSRCS)
+	@mkdir -p $(builddir)/$(*D)
+	$(PP) $(CFLAGS) -I$(builddir)/tests $< > $(builddir)/$*.c.pp
+	$(CC) $(CFLAGS) -I$(builddir)/tests -MMD -MF $(builddir)/$*.d -o $@ $^
+
+$(builddir)/%: tests/%.cpp $(LIB)
+	@mkdir -p $(builddir)/$(*D)
+	$(CXX) $(CXXFLAGS) -MMD -MF $(builddir)/$*.d -o $@ $^
+
 clean:
-	rm -rf $(builddir)/$(SUBDIR) $(LIB) $(TESTS)
+	rm -rf $(builddir)/$(SUBDIR) $(builddir)/tools $(builddir)/tests $(LIB) $(BINS) $(TESTS) $(BENCHES) $(FUZZERS)
 
 -include $(DEPS)
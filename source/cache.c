@@ -0,0 +1,429 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <flos/utils.h>
+
+#define MIN_BUCKETS 64
+
+/*
+ * Cached parse result. Public part is first so results handed out can be
+ * converted back. Key, strings of the result and arrays share one allocation.
+ */
+struct entry {
+    struct utils_parse parse;
+
+    struct shard *shard;               // NULL when not in a cache and not held in one, see orphans
+    struct entry *next;                // hash bucket chain
+    struct entry *lru_prev, *lru_next; // most recently used first, or held list
+    uint64_t hash;
+    size_t key_len;
+    const char *key;
+    size_t size;
+    unsigned refs; // references held by callers and by the cache
+    int cached;    // entry is still in the cache
+};
+
+struct shard {
+    pthread_mutex_t lock;
+    struct entry **buckets;
+    size_t nbuckets;
+    struct entry *lru_head, *lru_tail;
+    struct entry *held; // evicted entries still referenced by callers
+    size_t bytes, limit;
+    size_t entries;
+    unsigned long long hits, misses, evictions;
+};
+
+struct utils_parse_cache {
+    unsigned nshards;
+    struct shard shards[];
+};
+
+// Counts references of entries without a shard: too large to cache, or left by a destroyed cache
+static pthread_mutex_t orphans = PTHREAD_MUTEX_INITIALIZER;
+
+// FNV-1a, 64 bit
+static uint64_t hash_bytes(uint64_t h, const char *s, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/*
+ * Key is a byte telling whether POSIXLY_CORRECT is set, as utils_getopt()
+ * orders operands by it, then opts and argv[1..argc) each terminated by '\0';
+ * argv[0] does not change the result.
+ */
+static size_t key_length(int argc, char *const argv[], const char *opts) {
+    size_t n = 1 + strlen(opts) + 1;
+
+    for (int i = 1; i < argc; i++) {
+        n += strlen(argv[i]) + 1;
+    }
+
+    return n;
+}
+
+static void make_key(char *key, int argc, char *const argv[], const char *opts) {
+    size_t n = strlen(opts) + 1;
+
+    *key++ = getenv("POSIXLY_CORRECT") != NULL ? 'P' : '-';
+    memcpy(key, opts, n);
+    key += n;
+
+    for (int i = 1; i < argc; i++) {
+        n = strlen(argv[i]) + 1;
+        memcpy(key, argv[i], n);
+        key += n;
+    }
+}
+
+static void lru_unlink(struct shard *s, struct entry *e) {
+    if (e->lru_prev != NULL) {
+        e->lru_prev->lru_next = e->lru_next;
+    } else {
+        s->lru_head = e->lru_next;
+    }
+
+    if (e->lru_next != NULL) {
+        e->lru_next->lru_prev = e->lru_prev;
+    } else {
+        s->lru_tail = e->lru_prev;
+    }
+
+    e->lru_prev = e->lru_next = NULL;
+}
+
+static void lru_push(struct shard *s, struct entry *e) {
+    e->lru_prev = NULL;
+    e->lru_next = s->lru_head;
+
+    if (s->lru_head != NULL) {
+        s->lru_head->lru_prev = e;
+    } else {
+        s->lru_tail = e;
+    }
+
+    s->lru_head = e;
+}
+
+static void held_push(struct shard *s, struct entry *e) {
+    e->lru_prev = NULL;
+    e->lru_next = s->held;
+
+    if (s->held != NULL) {
+        s->held->lru_prev = e;
+    }
+
+    s->held = e;
+}
+
+static void held_unlink(struct shard *s, struct entry *e) {
+    if (e->lru_prev != NULL) {
+        e->lru_prev->lru_next = e->lru_next;
+    } else {
+        s->held = e->lru_next;
+    }
+
+    if (e->lru_next != NULL) {
+        e->lru_next->lru_prev = e->lru_prev;
+    }
+}
+
+static void remove_entry(struct shard *s, struct entry *e) {
+    struct entry **p = &s->buckets[e->hash % s->nbuckets];
+
+    while (*p != e) {
+        p = &(*p)->next;
+    }
+    *p = e->next;
+
+    lru_unlink(s, e);
+
+    s->bytes -= e->size;
+    s->entries--;
+    e->cached = 0;
+
+    if (--e->refs == 0) {
+        free(e);
+    } else {
+        held_push(s, e);
+    }
+}
+
+static struct entry *find(struct shard *s, uint64_t hash, const char *key, size_t key_len) {
+    for (struct entry *e = s->buckets[hash % s->nbuckets]; e != NULL; e = e->next) {
+        if (e->hash == hash && e->key_len == key_len && memcmp(e->key, key, key_len) == 0) {
+            return e;
+        }
+    }
+
+    return NULL;
+}
+
+static void grow(struct shard *s) {
+    size_t n = s->nbuckets * 2;
+    struct entry **b = calloc(n, sizeof(*b));
+
+    if (b == NULL) {
+        return; // keep longer chains
+    }
+
+    for (size_t i = 0; i < s->nbuckets; i++) {
+        struct entry *e = s->buckets[i];
+
+        while (e != NULL) {
+            struct entry *next = e->next;
+
+            e->next = b[e->hash % n];
+            b[e->hash % n] = e;
+            e = next;
+        }
+    }
+
+    free(s->buckets);
+    s->buckets = b;
+    s->nbuckets = n;
+}
+
+// Parses argv with utils_getopt() into one allocation that is never written afterwards.
+static struct entry *parse(int argc, const char *opts, const char *key, size_t key_len) {
+    size_t nargs = argc > 0 ? (size_t)argc : 1;
+    size_t nopts = key_len; // a cluster gives an option per character, each argument at least one
+    size_t size = sizeof(struct entry) + nopts * sizeof(struct utils_parse_option) + (nargs + 1) * sizeof(char *) +
+                  2 * key_len;
+    struct entry *e = calloc(1, size);
+
+    if (e == NULL) {
+        return NULL;
+    }
+
+    struct utils_parse_option *options = (struct utils_parse_option *)(e + 1);
+    char **args = (char **)(options + nopts);
+    char *k = (char *)(args + nargs + 1);
+    char *strings = k + key_len; // copy of arguments utils_getopt() may modify
+
+    memcpy(k, key, key_len);
+    memcpy(strings, key, key_len);
+
+    // Rebuild argv over the copy; argv[0] is not in the key, so it is the empty string ending opts
+    char *p = strings + 1 + strlen(opts);
+    args[0] = p++;
+    for (int i = 1; i < argc; i++) {
+        args[i] = p;
+        p += strlen(p) + 1;
+    }
+    args[nargs] = NULL;
+
+    int n = (int)nargs;
+    char **av = args;
+    char *optarg = NULL;
+    utf8_char c;
+
+    while ((c = utils_getopt(&n, &av, &optarg, opts)) != 0) {
+        options[e->parse.noptions].code = c;
+        options[e->parse.noptions].optarg = optarg;
+        e->parse.noptions++;
+    }
+
+    e->parse.options = options;
+    e->parse.noperands = n > 0 ? (size_t)n : 0;
+    e->parse.operands = (const char *const *)av;
+    e->key = k;
+    e->key_len = key_len;
+    e->size = size;
+
+    return e;
+}
+
+struct utils_parse_cache *utils_parse_cache_create(size_t max_bytes, unsigned shards) {
+    if (shards == 0) {
+        shards = 1;
+    }
+
+    struct utils_parse_cache *cache = calloc(1, sizeof(*cache) + shards * sizeof(struct shard));
+
+    if (cache == NULL) {
+        return NULL;
+    }
+
+    cache->nshards = shards;
+
+    for (unsigned i = 0; i < shards; i++) {
+        struct shard *s = &cache->shards[i];
+
+        s->nbuckets = MIN_BUCKETS;
+        s->buckets = calloc(s->nbuckets, sizeof(*s->buckets));
+        s->limit = max_bytes / shards;
+
+        if (s->buckets == NULL || pthread_mutex_init(&s->lock, NULL) != 0) {
+            free(s->buckets);
+            cache->nshards = i;
+            utils_parse_cache_destroy(cache);
+            return NULL;
+        }
+    }
+
+    return cache;
+}
+
+void utils_parse_cache_destroy(struct utils_parse_cache *cache) {
+    if (cache == NULL) {
+        return;
+    }
+
+    for (unsigned i = 0; i < cache->nshards; i++) {
+        struct shard *s = &cache->shards[i];
+
+        while (s->lru_head != NULL) {
+            remove_entry(s, s->lru_head);
+        }
+
+        // Results still referenced outlive the cache, released under orphans lock
+        for (struct entry *e = s->held; e != NULL; e = e->lru_next) {
+            e->shard = NULL;
+        }
+
+        free(s->buckets);
+        pthread_mutex_destroy(&s->lock);
+    }
+
+    free(cache);
+}
+
+const struct utils_parse *utils_parse_cached(struct utils_parse_cache *cache, int argc, char *const argv[],
+                                             const char *opts) {
+    if (cache == NULL || argv == NULL || opts == NULL) {
+        return NULL;
+    }
+
+    size_t key_len = key_length(argc, argv, opts);
+    char *key = malloc(key_len);
+
+    if (key == NULL) {
+        return NULL;
+    }
+
+    make_key(key, argc, argv, opts);
+
+    uint64_t hash = hash_bytes(0xcbf29ce484222325ULL, key, key_len);
+    struct shard *s = &cache->shards[(hash >> 32) % cache->nshards];
+    struct entry *e;
+
+    pthread_mutex_lock(&s->lock);
+    if ((e = find(s, hash, key, key_len)) != NULL) {
+        lru_unlink(s, e);
+        lru_push(s, e);
+        e->refs++;
+        s->hits++;
+        pthread_mutex_unlock(&s->lock);
+        free(key);
+        return &e->parse;
+    }
+    s->misses++;
+    pthread_mutex_unlock(&s->lock);
+
+    // Parse without holding the lock, other threads may insert same key meanwhile
+    struct entry *n = parse(argc, opts, key, key_len);
+
+    free(key);
+
+    if (n == NULL) {
+        return NULL;
+    }
+
+    n->hash = hash;
+    n->refs = 1;
+
+    pthread_mutex_lock(&s->lock);
+    if ((e = find(s, hash, n->key, n->key_len)) != NULL) {
+        e->refs++;
+        pthread_mutex_unlock(&s->lock);
+        free(n);
+        return &e->parse;
+    }
+
+    if (n->size <= s->limit) {
+        while (s->bytes + n->size > s->limit && s->lru_tail != NULL) {
+            remove_entry(s, s->lru_tail);
+            s->evictions++;
+        }
+
+        if (s->entries >= s->nbuckets) {
+            grow(s);
+        }
+
+        n->next = s->buckets[hash % s->nbuckets];
+        s->buckets[hash % s->nbuckets] = n;
+        lru_push(s, n);
+        n->shard = s;
+        n->cached = 1;
+        n->refs++;
+        s->bytes += n->size;
+        s->entries++;
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return &n->parse;
+}
+
+void utils_parse_release(const struct utils_parse *parse) {
+    if (parse == NULL) {
+        return;
+    }
+
+    struct entry *e = (struct entry *)parse;
+    struct shard *s = e->shard;
+    pthread_mutex_t *lock = s != NULL ? &s->lock : &orphans;
+    int last;
+
+    pthread_mutex_lock(lock);
+    last = --e->refs == 0;
+    if (last && s != NULL) {
+        held_unlink(s, e); // the cache holds a reference to entries in it, so this one was evicted
+    }
+    pthread_mutex_unlock(lock);
+
+    if (last) {
+        free(e);
+    }
+}
+
+void utils_parse_cache_get_stats(struct utils_parse_cache *cache, struct utils_parse_cache_stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+
+    for (unsigned i = 0; i < cache->nshards; i++) {
+        struct shard *s = &cache->shards[i];
+
+        pthread_mutex_lock(&s->lock);
+        stats->hits += s->hits;
+        stats->misses += s->misses;
+        stats->evictions += s->evictions;
+        stats->entries += s->entries;
+        stats->bytes += s->bytes + s->nbuckets * sizeof(*s->buckets);
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    stats->bytes += sizeof(*cache) + cache->nshards * sizeof(struct shard);
+}
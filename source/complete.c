@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <flos/utils.h>
+
+#include "rules.h"
+
+static const struct utils_option *find_short(const struct utils_option *options, size_t count, char c) {
+    for (size_t i = 0; i < count; i++) {
+        if (options[i].short_name == c) {
+            return &options[i];
+        }
+    }
+    return NULL;
+}
+
+static const struct utils_option *find_long(const struct utils_option *options, size_t count, const char *name,
+                                            size_t len) {
+    for (size_t i = 0; i < count; i++) {
+        if (options[i].long_name != NULL && strncmp(options[i].long_name, name, len) == 0 &&
+            options[i].long_name[len] == '\0') {
+            return &options[i];
+        }
+    }
+    return NULL;
+}
+
+static void add_match(const struct utils_option **matches, size_t max, size_t *found, const struct utils_option *o) {
+    if (*found < max) {
+        matches[*found] = o;
+    }
+    (*found)++;
+}
+
+// Returns option whose argument is the next word, or NULL.
+static const struct utils_option *scan_word(const char *word, const struct rules *rules) {
+    const char *p = word + 1;
+    enum short_option kind;
+
+    if (rules_word(word) == WORD_LONG) {
+        const char *name = word + 2;
+
+        return rules_long_takes_next(rules, name) ? find_long(rules->options, rules->count, name, strlen(name)) : NULL;
+    }
+
+    while ((kind = rules_short(rules, p)) == SHORT_CLUSTER) {
+        p++;
+    }
+
+    return kind == SHORT_NEXT ? find_short(rules->options, rules->count, *p) : NULL;
+}
+
+enum utils_completion utils_complete(int argc, char *argv[], int cursor, char mode, const struct utils_option *options,
+                                     size_t count, const struct utils_option **matches, size_t *nmatches) {
+    const struct utils_option *pending = NULL;
+    size_t max = *nmatches;
+    size_t found = 0;
+    struct rules rules;
+    int i;
+
+    *nmatches = 0;
+
+    if (argv == NULL || cursor < 1 || cursor > argc) {
+        return UTILS_COMPLETE_OPERAND;
+    }
+
+    rules_init_options(&rules, mode, options, count);
+
+    // Replay words before the cursor the same way the parser would
+    for (i = 1; i < cursor; i++) {
+        const char *word = argv[i];
+
+        if (pending != NULL) {
+            pending = NULL;
+            continue;
+        }
+
+        switch (rules_word(word)) {
+        case WORD_END:
+            return UTILS_COMPLETE_OPERAND; // everything after "--" is an operand
+        case WORD_OPERAND:
+            if (rules.ordering == REQUIRE_ORDER) {
+                return UTILS_COMPLETE_OPERAND; // options end at the first operand
+            }
+            continue; // operand is permuted or returned in order, it does not end options
+        case WORD_DASH:
+            continue;
+        default:
+            pending = scan_word(word, &rules);
+        }
+    }
+
+    const char *word = cursor < argc && argv[cursor] != NULL ? argv[cursor] : "";
+
+    if (pending != NULL) {
+        add_match(matches, max, &found, pending);
+        *nmatches = found;
+        return UTILS_COMPLETE_ARGUMENT;
+    }
+
+    if (word[0] != '-') {
+        return UTILS_COMPLETE_OPERAND;
+    }
+
+    if (word[1] == '-') {
+        const char *name = word + 2;
+        const char *value = strchr(name, '=');
+
+        if (value != NULL) {
+            const struct utils_option *o = find_long(options, count, name, value - name);
+
+            if (o == NULL || o->argument == UTILS_NO_ARGUMENT) {
+                return UTILS_COMPLETE_OPERAND;
+            }
+
+            add_match(matches, max, &found, o);
+            *nmatches = found;
+            return UTILS_COMPLETE_ARGUMENT;
+        }
+
+        size_t len = strlen(name);
+
+        for (size_t j = 0; j < count; j++) {
+            if (options[j].long_name != NULL && strncmp(options[j].long_name, name, len) == 0) {
+                add_match(matches, max, &found, &options[j]);
+            }
+        }
+    } else if (word[1] == '\0') {
+        for (size_t j = 0; j < count; j++) {
+            add_match(matches, max, &found, &options[j]);
+        }
+    } else {
+        const char *p = word + 1;
+        enum short_option kind;
+
+        while ((kind = rules_short(&rules, p)) == SHORT_CLUSTER) {
+            p++;
+        }
+
+        if (kind == SHORT_UNKNOWN || kind == SHORT_NOT_ALLOWED) {
+            return UTILS_COMPLETE_OPTION; // no matches
+        }
+
+        add_match(matches, max, &found, find_short(options, count, *p));
+
+        if (kind == SHORT_ATTACHED) {
+            *nmatches = found;
+            return UTILS_COMPLETE_ARGUMENT;
+        }
+    }
+
+    *nmatches = found;
+
+    return UTILS_COMPLETE_OPTION;
+}
@@ -15,26 +15,153 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <stdio.h>
+#include <stdlib.h>
 
 #include <flos/utils.h>
 
-static int is_short_name(int index) {
-    return (index >= 'a' && index <= 'z') || (index >= 'A' && index <= 'Z') || (index >= '0' && index <= '9');
+#include "rules.h"
+
+#define SHORT_RANGE 16 // words partitioned by moving each option over operands before it
+
+// Counts elements of argv written, only in the build of this file tests/fuzz-getopt.c links
+#ifdef UTILS_COUNT_WRITES
+size_t utils_getopt_writes;
+#define WRITTEN(n) (utils_getopt_writes += (n))
+#else
+#define WRITTEN(n) ((void)0)
+#endif
+
+static void reverse(char *argv[], size_t from, size_t to) {
+    WRITTEN(to - from);
+
+    while (from + 1 < to) {
+        char *tmp = argv[from];
+        argv[from++] = argv[--to];
+        argv[to] = tmp;
+    }
 }
 
-// Left-shifts array elements by 1, moving the first element to the end.
-static void shift(char *argv[]) {
-    char *first_element = argv[0];
-    while (argv[1] != NULL) {
-        argv[0] = argv[1];
-        argv++;
+// Swaps adjacent blocks argv[from..mid) and argv[mid..to), keeping order inside each.
+static void swap_blocks(char *argv[], size_t from, size_t mid, size_t to) {
+    if (from == mid || mid == to) {
+        return;
     }
-    argv[0] = first_element;
+
+    reverse(argv, from, mid);
+    reverse(argv, mid, to);
+    reverse(argv, from, to);
 }
 
-utf8_char utils_getopt(int *argc, char **argv[], char **optarg, const char *opts) {
-    if (*argc <= 0 || argv == NULL || *argv == NULL || **argv == NULL || optarg == NULL || opts == NULL) {
+// Left-rotates array elements by n, moving the first n elements to the end in their order.
+static void rotate(char *argv[], size_t n) {
+    size_t count = n;
+
+    while (argv[count] != NULL) {
+        count++;
+    }
+
+    swap_blocks(argv, 0, n, count);
+}
+
+// Returns number of operands argv[0..count) starts with
+static int operand_run(char *const argv[], int count) {
+    int i = 0;
+
+    while (i < count && argv[i][0] != '-') {
+        i++;
+    }
+
+    return i;
+}
+
+// Returns number of words of the unit at argv[i]: an operand, or an option with its argument word.
+// Sets *kept for an option and *end after "--", everything after which is an operand.
+static int unit(char *const argv[], int i, int count, const struct rules *rules, int *end, int *kept) {
+    const char *p = argv[i];
+    enum short_option kind;
+
+    *kept = !*end && p[0] == '-';
+
+    if (!*kept) {
+        return 1;
+    }
+
+    switch (rules_word(p)) {
+    case WORD_END:
+        *end = 1;
+        return 1;
+    case WORD_LONG:
+        return rules_long_takes_next(rules, p + 2) && i + 1 < count ? 2 : 1;
+    case WORD_SHORT:
+        p++;
+        while ((kind = rules_short(rules, p)) == SHORT_CLUSTER) {
+            p++;
+        }
+        return kind == SHORT_NEXT && i + 1 < count ? 2 : 1;
+    default:
+        return 1;
+    }
+}
+
+// Moves options of argv[from..to) before its operands keeping order of both, and returns their number. Halves are
+// split at a unit boundary and partitioned in turn, then operands of the first swapped with options of the second,
+// which moves each word O(log n) times without any memory. Runs of operands are stepped over without reading them as
+// units, and a range of operands only is left as is. End tells whether the range follows "--".
+static int partition(char *argv[], int from, int to, int count, const struct rules *rules, int end) {
+    int half = from + (to - from) / 2;
+    int mid = from, mid_end = end, kept;
+
+    if (end || operand_run(argv + from, to - from) == to - from) {
+        return 0;
+    }
+
+    if (to - from <= SHORT_RANGE) {
+        int options = 0, n;
+
+        for (int i = from; i < to; i += n) {
+            n = unit(argv, i, count, rules, &end, &kept);
+
+            if (kept) {
+                swap_blocks(argv, from + options, i, i + n);
+                options += n;
+            }
+        }
+
+        return options;
+    }
+
+    do {
+        int run = mid_end ? 0 : operand_run(argv + mid, half - mid);
+
+        mid += run > 0 ? run : unit(argv, mid, count, rules, &mid_end, &kept);
+    } while (mid < half);
+
+    int left = partition(argv, from, mid, count, rules, end);
+    int right = partition(argv, mid, to, count, rules, mid_end);
+
+    swap_blocks(argv, from + left, mid, mid + right);
+
+    return left + right;
+}
+
+// Moves all operands of argv[0..count) after the hidden ones, keeping their order, as rotating each run of
+// operands in turn would. Words are skipped as option arguments by the same rules as the parser reads them.
+// Returns number of operands moved.
+static int permute(char *argv[], int count, const struct rules *rules) {
+    int kept = count > 0 ? partition(argv, 0, count, count, rules, 0) : 0;
+    int hidden = 0;
+
+    while (argv[count + hidden] != NULL) {
+        hidden++;
+    }
+
+    swap_blocks(argv, kept, count, count + hidden);
+
+    return count - kept;
+}
+
+static utf8_char next_option(int *argc, char **argv[], char **optarg, const struct rules *rules) {
+    if (*argc <= 0 || argv == NULL || *argv == NULL || **argv == NULL || optarg == NULL || rules == NULL) {
         goto finished;
     }
 
@@ -58,83 +185,42 @@ start:
 
     argp = **argv;
 
-    if (*argp == '-') { // option
-        argp++;
-        if (*argp == '-') { // long option
-            argp++;
-
-            // handle "end of options" (--)
-            if (*argp == '\0') {
-                (*argv)++;
-                (*argc)--;
-
-                // shift all remaining operands
-                if ((*argv)[*argc] != NULL) {
-                    while (*argc) {
-                        shift(*argv);
-                        (*argc)--;
-                    }
-                }
-
-                goto finished;
-            }
+    switch (rules_word(argp)) {
+    case WORD_END: // "end of options"
+        (*argv)++;
+        (*argc)--;
 
-            *optarg = argp + 1;
-
-            return 2;
-        } else if (*argp == '\0') { // a single '-'
-
-            // shall return -1 without changing optind
-
-            return -1;
-        } else {
-            const char *opt = opts;
-
-            int optional = *opt == ':' ? (opt++, 0) : 1;
-
-            while (*opt) {
-                if (*opt != ':' && *opt == *argp) {
-                    if (*(argp + 1) == '\0') { // no characters are attached
-                        if (!optional && *(opt + 1) == ':') {
-                            (*argv)++;
-                            (*argc)--;
-
-                            if (*argc == 0 || (*optarg = **argv) == NULL) {
-                                fprintf(stderr, "Option -%c requires an argument.\n", *argp);
-                                *optarg = argp;
-                                return ':';
-                            }
-                        }
-                    } else { //
-                        if (!optional && *(opt + 1) == ':') {
-                            *optarg = argp + 1;
-                        } else {
-                            if (!is_short_name(*(argp + 1))) {
-                                fprintf(stderr, "Option -%c doesn't allow an argument.\n", *argp);
-                                return '?';
-                            }
-
-                            *argp = '-';
-                            **argv = argp; // scan here again next round
-                            (*argv)--;
-                            (*argc)++;
-                        }
-                    }
-                    return *opt;
-                }
-                opt++;
-            }
+        // move all remaining operands after the hidden ones
+        if ((*argv)[*argc] != NULL) {
+            rotate(*argv, *argc);
+            *argc = 0;
+        }
 
-            *optarg = argp;
+        goto finished;
+    case WORD_LONG:
+        *optarg = argp + 3;
+
+        return 2;
+    case WORD_DASH:
+        // shall return -1 without changing optind
 
-            fprintf(stderr, "Unknown option: -%c\n", *argp); // TODO: utf8
+        return -1;
+    case WORD_SHORT:
+        break;
+    default:
+        if (rules->ordering == REQUIRE_ORDER) {
+            // Options end at the first operand, argv[] is left as is.
+            goto finished;
+        }
+
+        if (rules->ordering == RETURN_IN_ORDER) {
+            *optarg = argp;
 
-            return '?';
+            return 1;
         }
-    } else {
-        // Move operand to the end of argv[] and hide it for now.
-        shift(*argv);
-        (*argc)--; // Hide it.
+
+        // Move all operands to the end of argv[] and hide them for now.
+        *argc -= permute(*argv, *argc, rules); // Hide them.
 
         if (*argc == 0) {
             goto finished;
@@ -143,6 +229,38 @@ start:
         goto start;
     }
 
+    char c = *++argp;
+    enum short_option kind = rules_short(rules, argp);
+
+    switch (kind) {
+    case SHORT_ATTACHED:
+        *optarg = argp + 1;
+        return c;
+    case SHORT_NEXT:
+        (*argv)++;
+        (*argc)--;
+
+        if (*argc == 0 || (*optarg = **argv) == NULL) {
+            *optarg = argp;
+            return rules_error(rules, kind, c);
+        }
+        return c;
+    case SHORT_CLUSTER:
+        *argp = '-';
+        **argv = argp; // scan here again next round
+        WRITTEN(1);
+        (*argv)--;
+        (*argc)++;
+        return c;
+    case SHORT_FLAG:
+        return c;
+    case SHORT_UNKNOWN:
+        *optarg = argp;
+        return rules_error(rules, kind, c);
+    default:
+        return rules_error(rules, kind, c);
+    }
+
 finished:
     // Unhide previously hidden operands
     while ((*argv)[*argc] != NULL) {
@@ -151,3 +269,39 @@ finished:
 
     return 0;
 }
+
+utf8_char utils_getopt(int *argc, char **argv[], char **optarg, const char *opts) {
+    struct rules rules;
+
+    if (opts == NULL) {
+        return next_option(argc, argv, optarg, NULL);
+    }
+
+    rules_init(&rules, opts);
+
+    return next_option(argc, argv, optarg, &rules);
+}
+
+utf8_char utils_getopt_table(int *argc, char **argv[], char **optarg, const struct utils_opts_table *table) {
+    struct rules rules;
+
+    if (table == NULL) {
+        return next_option(argc, argv, optarg, NULL);
+    }
+
+    rules_init_table(&rules, table);
+
+    return next_option(argc, argv, optarg, &rules);
+}
+
+int utils_permute(int count, char *argv[], const struct utils_option *options, size_t noptions) {
+    struct rules rules;
+
+    if (count <= 0 || argv == NULL || options == NULL) {
+        return 0;
+    }
+
+    rules_init_options(&rules, '\0', options, noptions);
+
+    return permute(argv, count, &rules);
+}
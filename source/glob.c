@@ -0,0 +1,602 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _DEFAULT_SOURCE // d_type of struct dirent
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <flos/utils.h>
+
+#include "pool.h"
+
+#define AHEAD 64 // directories each worker may read ahead of the caller
+
+enum kind {
+    LITERAL, // name without special characters, no need to read directory
+    MATCH,   // fnmatch() pattern
+    RECURSE, // "**"
+};
+
+struct component {
+    enum kind kind;
+    char *text;
+};
+
+struct pattern {
+    const char *text;
+    size_t ncomponents;
+    struct component *components;
+    size_t matches;
+    struct node *root; // until taken by caller, NULL for pattern without special characters
+};
+
+enum state {
+    PENDING, // waiting in work queue
+    RUNNING, // being read by a worker or the caller
+    READY,   // items are filled in
+};
+
+// Either a matched path or a directory still to be read
+struct item {
+    char *path;
+    struct node *child;
+};
+
+/*
+ * Directory path and index of the first pattern component to match in it.
+ * Reading it makes a sorted list of items. Path is "" for current directory.
+ */
+struct node {
+    struct pattern *pattern;
+    char *path;
+    size_t component;
+    enum state state;
+    int failed; // out of memory while reading
+    int queued;
+    struct item *items;
+    size_t nitems, pos, capacity;
+    struct node *prev, *next; // work queue
+};
+
+struct utils_glob {
+    struct pool pool;   // tasks are nodes
+    struct node *queue; // most recently added first
+    size_t live;        // nodes read but not freed yet
+
+    size_t npatterns, next;
+    struct pattern *pattern; // being expanded by caller
+    struct node **stack;     // path from root of pattern to current directory
+    size_t depth, max_depth;
+
+    struct pattern patterns[];
+};
+
+static char *join(const char *dir, const char *name) {
+    size_t n = strlen(dir), m = strlen(name);
+    int slash = n > 0 && dir[n - 1] != '/';
+    char *path = malloc(n + slash + m + 1);
+
+    if (path != NULL) {
+        memcpy(path, dir, n);
+        if (slash) {
+            path[n] = '/';
+        }
+        memcpy(path + n + slash, name, m + 1);
+    }
+
+    return path;
+}
+
+static int is_special(const char *s) {
+    return strpbrk(s, "*?[\\") != NULL;
+}
+
+static int compile(struct pattern *p, const char *text) {
+    size_t n = 1;
+
+    p->text = text;
+
+    for (const char *s = text; *s != '\0'; s++) {
+        n += *s == '/';
+    }
+
+    if ((p->components = calloc(n, sizeof(*p->components))) == NULL) {
+        return -1;
+    }
+
+    for (const char *s = text; *s != '\0';) {
+        size_t len = strcspn(s, "/");
+
+        if (len > 0) {
+            struct component *c = &p->components[p->ncomponents];
+
+            if (len == 2 && s[0] == '*' && s[1] == '*') {
+                c->kind = RECURSE;
+                if (p->ncomponents > 0 && c[-1].kind == RECURSE) {
+                    s += len; // "**/**" is same as "**"
+                    continue;
+                }
+            } else {
+                c->kind = memchr(s, '*', len) || memchr(s, '?', len) || memchr(s, '[', len) ||
+                                  memchr(s, '\\', len)
+                              ? MATCH
+                              : LITERAL;
+            }
+
+            if ((c->text = strndup(s, len)) == NULL) {
+                return -1;
+            }
+            p->ncomponents++;
+        }
+
+        s += len + (s[len] == '/');
+    }
+
+    return 0;
+}
+
+// Makes node of path dir/name, appending literal components that need no directory read
+static struct node *make_node(struct pattern *p, const char *dir, const char *name, size_t component) {
+    struct node *n = calloc(1, sizeof(*n));
+
+    if (n == NULL) {
+        return NULL;
+    }
+
+    n->pattern = p;
+    n->path = name != NULL ? join(dir, name) : strdup(dir);
+
+    while (n->path != NULL && component < p->ncomponents && p->components[component].kind == LITERAL) {
+        char *path = join(n->path, p->components[component++].text);
+
+        free(n->path);
+        n->path = path;
+    }
+
+    if (n->path == NULL) {
+        free(n);
+        return NULL;
+    }
+
+    n->component = component;
+
+    return n;
+}
+
+static void free_node(struct node *n) {
+    for (size_t i = 0; i < n->nitems; i++) {
+        if (n->items[i].child == NULL) {
+            free(n->items[i].path);
+        } else if (i >= n->pos) {
+            free_node(n->items[i].child); // not visited by caller yet
+        }
+    }
+
+    free(n->items);
+    free(n->path);
+    free(n);
+}
+
+static int add_item(struct node *n, char *path, struct node *child) {
+    if (path == NULL && child == NULL) {
+        return -1;
+    }
+
+    if (n->nitems == n->capacity) {
+        size_t capacity = n->capacity ? n->capacity * 2 : 16;
+        struct item *items = realloc(n->items, capacity * sizeof(*items));
+
+        if (items == NULL) {
+            free(path);
+            if (child != NULL) {
+                free_node(child);
+            }
+            return -1;
+        }
+
+        n->items = items;
+        n->capacity = capacity;
+    }
+
+    n->items[n->nitems].path = path;
+    n->items[n->nitems].child = child;
+    n->nitems++;
+
+    return 0;
+}
+
+struct entry {
+    char *name;
+    unsigned char type;
+};
+
+static int compare_entries(const void *a, const void *b) {
+    return strcmp(((const struct entry *)a)->name, ((const struct entry *)b)->name);
+}
+
+static int is_directory(int fd, const struct entry *e, int follow) {
+    struct stat st;
+
+    if (e->type == DT_DIR) {
+        return 1;
+    }
+    if (e->type != DT_UNKNOWN && (e->type != DT_LNK || !follow)) {
+        return 0;
+    }
+
+    return fstatat(fd, e->name, &st, follow ? 0 : AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+}
+
+// Adds matches of component in directory, entries of directory are sorted
+static int match(struct node *n, int fd, const struct entry *entries, size_t count, size_t component) {
+    struct pattern *p = n->pattern;
+    int last = component + 1 == p->ncomponents;
+
+    for (size_t i = 0; i < count; i++) {
+        const struct entry *e = &entries[i];
+        int r = 0;
+
+        if (component == p->ncomponents) {
+            // trailing "**" matches every name below
+            if (e->name[0] != '.') {
+                r = add_item(n, join(n->path, e->name), NULL);
+            }
+        } else if (fnmatch(p->components[component].text, e->name, FNM_PERIOD) == 0) {
+            if (last) {
+                r = add_item(n, join(n->path, e->name), NULL);
+            } else if (is_directory(fd, e, 1)) {
+                r = add_item(n, NULL, make_node(p, n->path, e->name, component + 1));
+            }
+        }
+
+        if (r != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int read_node(struct node *n) {
+    struct pattern *p = n->pattern;
+    struct entry *entries = NULL;
+    size_t count = 0, capacity = 0;
+    struct dirent *d;
+    struct stat st;
+    int r = 0;
+
+    if (n->component == p->ncomponents) {
+        // only literal components were left
+        if (lstat(n->path, &st) == 0) {
+            return add_item(n, strdup(n->path), NULL);
+        }
+        return 0;
+    }
+
+    DIR *dir = opendir(n->path[0] != '\0' ? n->path : ".");
+
+    if (dir == NULL) {
+        return 0; // unreadable directories have no matches, like glob() without GLOB_ERR
+    }
+
+    while ((d = readdir(dir)) != NULL) {
+        if (strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0) {
+            continue;
+        }
+
+        if (count == capacity) {
+            size_t c = capacity ? capacity * 2 : 64;
+            struct entry *e = realloc(entries, c * sizeof(*e));
+
+            if (e == NULL) {
+                r = -1;
+                break;
+            }
+            entries = e;
+            capacity = c;
+        }
+
+        if ((entries[count].name = strdup(d->d_name)) == NULL) {
+            r = -1;
+            break;
+        }
+        entries[count++].type = d->d_type;
+    }
+
+    if (r == 0) {
+        qsort(entries, count, sizeof(*entries), compare_entries);
+
+        if (p->components[n->component].kind == RECURSE) {
+            // zero directories first, then every directory below
+            r = match(n, dirfd(dir), entries, count, n->component + 1);
+
+            for (size_t i = 0; r == 0 && i < count; i++) {
+                if (entries[i].name[0] != '.' && is_directory(dirfd(dir), &entries[i], 0)) {
+                    r = add_item(n, NULL, make_node(p, n->path, entries[i].name, n->component));
+                }
+            }
+        } else {
+            r = match(n, dirfd(dir), entries, count, n->component);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        free(entries[i].name);
+    }
+    free(entries);
+    closedir(dir);
+
+    return r;
+}
+
+static void enqueue(struct utils_glob *glob, struct node *n) {
+    n->queued = 1;
+    n->prev = NULL;
+    n->next = glob->queue;
+    if (glob->queue != NULL) {
+        glob->queue->prev = n;
+    }
+    glob->queue = n;
+}
+
+static void dequeue(struct utils_glob *glob, struct node *n) {
+    if (!n->queued) {
+        return;
+    }
+
+    if (n->prev != NULL) {
+        n->prev->next = n->next;
+    } else {
+        glob->queue = n->next;
+    }
+    if (n->next != NULL) {
+        n->next->prev = n->prev;
+    }
+    n->prev = n->next = NULL;
+    n->queued = 0;
+}
+
+// Marks node as taken, with lock held
+static void start(struct utils_glob *glob, struct node *n) {
+    dequeue(glob, n);
+    n->state = RUNNING;
+    glob->live++;
+}
+
+static void *take(void *owner) {
+    struct utils_glob *glob = owner;
+    struct node *n = glob->queue;
+
+    if (n == NULL || glob->live >= glob->pool.ahead) {
+        return NULL;
+    }
+
+    start(glob, n);
+
+    return n;
+}
+
+static int run(void *owner, void *task) {
+    (void)owner;
+
+    return read_node(task) != 0;
+}
+
+static void done(void *owner, void *task, int failed) {
+    struct utils_glob *glob = owner;
+    struct node *n = task;
+
+    n->failed = failed;
+    n->state = READY;
+
+    // Last child ends deepest in queue, so the caller's next directory is read first
+    if (glob->pool.ahead > 0) {
+        for (size_t i = n->nitems; i-- > 0;) {
+            if (n->items[i].child != NULL) {
+                enqueue(glob, n->items[i].child);
+            }
+        }
+        pthread_cond_broadcast(&glob->pool.work);
+    }
+}
+
+// Waits for node, reading it right away when no worker has taken it
+static int wait_ready(struct utils_glob *glob, struct node *n) {
+    pthread_mutex_lock(&glob->pool.lock);
+    if (n->state == PENDING) {
+        start(glob, n);
+        pool_run(&glob->pool, n);
+    }
+    while (n->state != READY) {
+        pthread_cond_wait(&glob->pool.ready, &glob->pool.lock);
+    }
+    pthread_mutex_unlock(&glob->pool.lock);
+
+    if (n->failed) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void release(struct utils_glob *glob, struct node *n) {
+    pthread_mutex_lock(&glob->pool.lock);
+    glob->live--;
+    pthread_cond_signal(&glob->pool.work);
+    pthread_mutex_unlock(&glob->pool.lock);
+
+    free_node(n);
+}
+
+static int push(struct utils_glob *glob, struct node *n) {
+    if (glob->depth == glob->max_depth) {
+        size_t depth = glob->max_depth ? glob->max_depth * 2 : 16;
+        struct node **stack = realloc(glob->stack, depth * sizeof(*stack));
+
+        if (stack == NULL) {
+            return -1;
+        }
+
+        glob->stack = stack;
+        glob->max_depth = depth;
+    }
+
+    glob->stack[glob->depth++] = n;
+
+    return 0;
+}
+
+struct utils_glob *utils_glob_create(size_t count, char *const patterns[], unsigned threads) {
+    struct utils_glob *glob = calloc(1, sizeof(*glob) + count * sizeof(struct pattern));
+
+    if (glob == NULL) {
+        return NULL;
+    }
+
+    if (pool_init(&glob->pool, glob, threads, AHEAD) != 0) {
+        free(glob);
+        return NULL;
+    }
+
+    glob->pool.take = take;
+    glob->pool.run = run;
+    glob->pool.done = done;
+    glob->npatterns = count;
+
+    for (size_t i = 0; i < count; i++) {
+        struct pattern *p = &glob->patterns[i];
+
+        if (compile(p, patterns[i]) != 0) {
+            utils_glob_destroy(glob);
+            return NULL;
+        }
+
+        if (is_special(patterns[i])) {
+            if ((p->root = make_node(p, patterns[i][0] == '/' ? "/" : "", NULL, 0)) == NULL) {
+                utils_glob_destroy(glob);
+                return NULL;
+            }
+        }
+    }
+
+    if (threads > 0) {
+        // Roots are queued in reverse, so patterns are read ahead in order
+        for (size_t i = count; i-- > 0;) {
+            if (glob->patterns[i].root != NULL) {
+                enqueue(glob, glob->patterns[i].root);
+            }
+        }
+
+        pool_start(&glob->pool, threads);
+    }
+
+    return glob;
+}
+
+int utils_glob_next(struct utils_glob *glob, const char **path) {
+    for (;;) {
+        if (glob->depth == 0) {
+            struct pattern *p = glob->pattern;
+
+            glob->pattern = NULL;
+            if (p != NULL && p->matches == 0) {
+                *path = p->text;
+                return 1;
+            }
+
+            if (glob->next == glob->npatterns) {
+                return 0;
+            }
+
+            p = &glob->patterns[glob->next++];
+            if (p->root == NULL) {
+                *path = p->text;
+                return 1;
+            }
+
+            if (push(glob, p->root) != 0) {
+                return -1;
+            }
+            p->root = NULL;
+            glob->pattern = p;
+        }
+
+        struct node *n = glob->stack[glob->depth - 1];
+
+        if (wait_ready(glob, n) != 0) {
+            return -1;
+        }
+
+        if (n->pos == n->nitems) {
+            glob->depth--;
+            release(glob, n);
+            continue;
+        }
+
+        struct item *item = &n->items[n->pos];
+
+        if (item->child != NULL) {
+            if (push(glob, item->child) != 0) {
+                return -1;
+            }
+            n->pos++;
+            continue;
+        }
+
+        n->pos++;
+        glob->pattern->matches++;
+        *path = item->path;
+        return 1;
+    }
+}
+
+void utils_glob_destroy(struct utils_glob *glob) {
+    if (glob == NULL) {
+        return;
+    }
+
+    pool_stop(&glob->pool);
+
+    // Each node on the stack owns unvisited nodes below it
+    while (glob->depth > 0) {
+        free_node(glob->stack[--glob->depth]);
+    }
+
+    for (size_t i = 0; i < glob->npatterns; i++) {
+        struct pattern *p = &glob->patterns[i];
+
+        if (p->root != NULL) {
+            free_node(p->root);
+        }
+        for (size_t j = 0; j < p->ncomponents; j++) {
+            free(p->components[j].text);
+        }
+        free(p->components);
+    }
+
+    pool_destroy(&glob->pool);
+    free(glob->stack);
+    free(glob);
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Workers doing tasks ahead of a caller that consumes their results in its
+ * own order, as glob and prefetch do. The owner tells which task may be
+ * taken next and what doing it means; the caller does a task itself rather
+ * than wait for one nobody has taken. Internal to the library.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+#include <stdlib.h>
+
+struct pool {
+    pthread_mutex_t lock;
+    pthread_cond_t work;  // a task may be taken
+    pthread_cond_t ready; // a task is done
+    int stop;
+    size_t ahead; // most tasks done but not consumed by the caller, 0 without workers
+
+    void *owner;
+    void *(*take)(void *owner);                      // next task marked taken, or NULL; lock held
+    int (*run)(void *owner, void *task);             // does task; lock released
+    void (*done)(void *owner, void *task, int code); // stores result of run; lock held
+
+    unsigned nthreads;
+    pthread_t *threads;
+};
+
+/*
+ * Prepares pool of owner for threads workers each allowed ahead tasks ahead of
+ * the caller. Returns -1 when out of memory.
+ */
+static inline int pool_init(struct pool *pool, void *owner, unsigned threads, size_t ahead) {
+    if (threads > 0 && (pool->threads = calloc(threads, sizeof(*pool->threads))) == NULL) {
+        return -1;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->ready, NULL);
+    pool->owner = owner;
+    pool->ahead = (size_t)threads * ahead;
+
+    return 0;
+}
+
+// Does task taken with lock held, releasing it meanwhile
+static inline void pool_run(struct pool *pool, void *task) {
+    pthread_mutex_unlock(&pool->lock);
+    int code = pool->run(pool->owner, task);
+    pthread_mutex_lock(&pool->lock);
+
+    pool->done(pool->owner, task, code);
+    pthread_cond_broadcast(&pool->ready);
+}
+
+static inline void *pool_worker(void *arg) {
+    struct pool *pool = arg;
+    void *task;
+
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->stop) {
+        if ((task = pool->take(pool->owner)) != NULL) {
+            pool_run(pool, task);
+        } else {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+// Starts workers, once tasks and callbacks are set
+static inline void pool_start(struct pool *pool, unsigned threads) {
+    for (; pool->nthreads < threads; pool->nthreads++) {
+        if (pthread_create(&pool->threads[pool->nthreads], NULL, pool_worker, pool) != 0) {
+            break; // fewer workers, the caller does the rest
+        }
+    }
+}
+
+// Stops and joins workers, a task being done is finished first
+static inline void pool_stop(struct pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (unsigned i = 0; i < pool->nthreads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pool->nthreads = 0;
+}
+
+// Frees pool initialized by pool_init(), after pool_stop()
+static inline void pool_destroy(struct pool *pool) {
+    pthread_cond_destroy(&pool->ready);
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+}
+
+#endif /* POOL_H */
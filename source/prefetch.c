@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <flos/utils.h>
+
+#include "pool.h"
+
+#define AHEAD 32 // operands each worker may resolve ahead of the caller
+
+enum state {
+    WAITING,  // not taken by anyone
+    RUNNING,  // being resolved
+    RESOLVED, // in ready queue
+    RETURNED, // given to the caller
+};
+
+struct slot {
+    enum state state;
+    int fd;
+    int error;
+    struct stat st;
+};
+
+struct utils_prefetch {
+    struct pool pool; // tasks are slots
+    char *const *operands;
+    size_t count;
+    int flags;
+    size_t next;     // first operand not taken by a worker
+    size_t returned; // operands given to the caller
+    size_t *queue;   // resolved operands, in order of completion
+    size_t head, tail;
+    struct slot slots[];
+};
+
+static void resolve(struct utils_prefetch *prefetch, size_t i) {
+    struct slot *s = &prefetch->slots[i];
+    const char *path = prefetch->operands[i];
+
+    s->fd = -1;
+    s->error = 0;
+
+    if (prefetch->flags & UTILS_PREFETCH_OPEN) {
+        // fstat() of the descriptor is of the same file the caller reads
+        if ((s->fd = open(path, O_RDONLY | O_CLOEXEC)) < 0 || fstat(s->fd, &s->st) != 0) {
+            s->error = errno;
+            if (s->fd >= 0) {
+                close(s->fd);
+                s->fd = -1;
+            }
+        }
+    } else if (stat(path, &s->st) != 0) {
+        s->error = errno;
+    }
+}
+
+static int can_take(struct utils_prefetch *prefetch) {
+    size_t window = prefetch->pool.ahead > 0 ? prefetch->pool.ahead : 1;
+
+    return prefetch->next < prefetch->count && prefetch->next < prefetch->returned + window;
+}
+
+static void *take(void *owner) {
+    struct utils_prefetch *prefetch = owner;
+
+    if (!can_take(prefetch)) {
+        return NULL;
+    }
+
+    prefetch->slots[prefetch->next].state = RUNNING;
+
+    return &prefetch->slots[prefetch->next++];
+}
+
+static int run(void *owner, void *task) {
+    struct utils_prefetch *prefetch = owner;
+
+    resolve(prefetch, (size_t)((struct slot *)task - prefetch->slots));
+
+    return 0;
+}
+
+static void done(void *owner, void *task, int code) {
+    struct utils_prefetch *prefetch = owner;
+    struct slot *s = task;
+
+    (void)code;
+    s->state = RESOLVED;
+    prefetch->queue[prefetch->tail++] = (size_t)(s - prefetch->slots);
+}
+
+struct utils_prefetch *utils_prefetch_create(size_t count, char *const operands[], int flags, unsigned threads) {
+    struct utils_prefetch *prefetch = calloc(1, sizeof(*prefetch) + count * sizeof(struct slot));
+
+    if (prefetch == NULL) {
+        return NULL;
+    }
+
+    prefetch->operands = operands;
+    prefetch->count = count;
+    prefetch->flags = flags;
+
+    if ((prefetch->queue = malloc((count ? count : 1) * sizeof(*prefetch->queue))) == NULL ||
+        pool_init(&prefetch->pool, prefetch, threads, AHEAD) != 0) {
+        free(prefetch->queue);
+        free(prefetch);
+        return NULL;
+    }
+
+    prefetch->pool.take = take;
+    prefetch->pool.run = run;
+    prefetch->pool.done = done;
+    pool_start(&prefetch->pool, threads);
+
+    return prefetch;
+}
+
+int utils_prefetch_next(struct utils_prefetch *prefetch, struct utils_prefetch_result *result) {
+    int in_order = prefetch->flags & UTILS_PREFETCH_IN_ORDER;
+    size_t i;
+
+    pthread_mutex_lock(&prefetch->pool.lock);
+    if (prefetch->returned == prefetch->count) {
+        pthread_mutex_unlock(&prefetch->pool.lock);
+        return 0;
+    }
+
+    for (;;) {
+        if (in_order) {
+            i = prefetch->returned;
+            if (prefetch->slots[i].state == RESOLVED) {
+                break;
+            }
+        } else if (prefetch->head < prefetch->tail) {
+            i = prefetch->queue[prefetch->head++];
+            break;
+        }
+
+        // Rather than wait, resolve an operand nobody has taken
+        if (can_take(prefetch) && (!in_order || prefetch->next == i)) {
+            pool_run(&prefetch->pool, take(prefetch));
+        } else {
+            pthread_cond_wait(&prefetch->pool.ready, &prefetch->pool.lock);
+        }
+    }
+
+    struct slot *s = &prefetch->slots[i];
+
+    s->state = RETURNED;
+    prefetch->returned++;
+    pthread_cond_broadcast(&prefetch->pool.work);
+    pthread_mutex_unlock(&prefetch->pool.lock);
+
+    result->index = i;
+    result->path = prefetch->operands[i];
+    result->fd = s->fd;
+    result->error = s->error;
+    result->st = s->st;
+
+    return 1;
+}
+
+void utils_prefetch_destroy(struct utils_prefetch *prefetch) {
+    if (prefetch == NULL) {
+        return;
+    }
+
+    pool_stop(&prefetch->pool);
+
+    for (size_t i = 0; i < prefetch->count; i++) {
+        if (prefetch->slots[i].state == RESOLVED && prefetch->slots[i].fd >= 0) {
+            close(prefetch->slots[i].fd);
+        }
+    }
+
+    pool_destroy(&prefetch->pool);
+    free(prefetch->queue);
+    free(prefetch);
+}
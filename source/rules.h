@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Rules of utils_getopt() shared by the parsers built on them, so a word is
+ * read the same way whether argv is parsed at once, in steps or replayed for
+ * completion. Internal to the library.
+ */
+
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <flos/utils.h>
+
+// How operands are handled, selected by leading '+' or '-' in opts
+enum ordering {
+    PERMUTE,         // move operands to the end of argv[]
+    REQUIRE_ORDER,   // stop at the first operand ('+' or POSIXLY_CORRECT)
+    RETURN_IN_ORDER, // return each operand as option 1 ('-')
+};
+
+struct rules {
+    enum ordering ordering;
+    int silent;                         // leading ':' suppresses diagnostics
+    const char *opts;                   // option characters, without ordering prefix and leading ':'
+    const unsigned char *kinds;         // enum utils_opt_kind by character, used instead of opts when set
+    const struct utils_option *options; // option table used instead of opts when set, long names included
+    size_t count;
+};
+
+enum word {
+    WORD_OPERAND, // "file" or ""
+    WORD_DASH,    // "-", returned as -1
+    WORD_END,     // "--", end of options
+    WORD_LONG,    // "--name", returned as 2
+    WORD_SHORT,   // "-abc"
+};
+
+// What an option character of a cluster is
+enum short_option {
+    SHORT_FLAG,        // option without an argument, last of the cluster
+    SHORT_CLUSTER,     // option without an argument, more options follow
+    SHORT_ATTACHED,    // argument is the rest of the word
+    SHORT_NEXT,        // argument is the next word
+    SHORT_NOT_ALLOWED, // followed by a character which cannot be an option
+    SHORT_UNKNOWN,     // not in opts
+};
+
+static inline enum ordering rules_ordering(char prefix) {
+    if (prefix == '+') {
+        return REQUIRE_ORDER;
+    }
+    if (prefix == '-') {
+        return RETURN_IN_ORDER;
+    }
+    return getenv("POSIXLY_CORRECT") != NULL ? REQUIRE_ORDER : PERMUTE;
+}
+
+static inline void rules_init(struct rules *rules, const char *opts) {
+    rules->ordering = rules_ordering(*opts);
+
+    if (*opts == '+' || *opts == '-') {
+        opts++;
+    }
+
+    rules->silent = *opts == ':';
+    rules->opts = opts + rules->silent;
+    rules->kinds = NULL;
+    rules->options = NULL;
+}
+
+static inline void rules_init_table(struct rules *rules, const struct utils_opts_table *table) {
+    rules->ordering = rules_ordering(table->ordering);
+    rules->silent = table->silent;
+    rules->opts = NULL;
+    rules->kinds = table->kinds;
+    rules->options = NULL;
+}
+
+// Rules of parsers generated by optgen, mode being their %mode
+static inline void rules_init_options(struct rules *rules, char mode, const struct utils_option *options,
+                                      size_t count) {
+    rules->ordering = rules_ordering(mode);
+    rules->silent = 1;
+    rules->opts = NULL;
+    rules->kinds = NULL;
+    rules->options = options;
+    rules->count = count;
+}
+
+static inline int rules_is_short_name(int c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+}
+
+static inline enum word rules_word(const char *word) {
+    if (word[0] != '-') {
+        return WORD_OPERAND;
+    }
+    if (word[1] == '\0') {
+        return WORD_DASH;
+    }
+    if (word[1] == '-') {
+        return word[2] == '\0' ? WORD_END : WORD_LONG;
+    }
+    return WORD_SHORT;
+}
+
+// Returns whether short option c takes an argument, -1 when it is not in opts
+static inline int rules_takes_argument(const struct rules *rules, char c) {
+    if (rules->kinds != NULL) {
+        return (unsigned char)c < 128 ? (int)rules->kinds[(unsigned char)c] - 1 : -1;
+    }
+
+    if (rules->options != NULL) {
+        for (size_t i = 0; i < rules->count; i++) {
+            if (rules->options[i].short_name == c) {
+                return rules->options[i].argument != UTILS_NO_ARGUMENT;
+            }
+        }
+        return -1;
+    }
+
+    for (const char *opt = rules->opts; *opt; opt++) {
+        if (*opt != ':' && *opt == c) {
+            return opt[1] == ':';
+        }
+    }
+
+    return -1;
+}
+
+// Returns whether "--name" takes the next word as argument, which only options of a table with long names do
+static inline int rules_long_takes_next(const struct rules *rules, const char *name) {
+    if (rules->options == NULL || strchr(name, '=') != NULL) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < rules->count; i++) {
+        if (rules->options[i].long_name != NULL && strcmp(rules->options[i].long_name, name) == 0) {
+            return rules->options[i].argument != UTILS_NO_ARGUMENT;
+        }
+    }
+
+    return 0;
+}
+
+// Tells what option character at p of a cluster is
+static inline enum short_option rules_short(const struct rules *rules, const char *p) {
+    int argument = rules_takes_argument(rules, *p);
+
+    if (argument < 0) {
+        return SHORT_UNKNOWN;
+    }
+    if (argument > 0) {
+        return p[1] != '\0' ? SHORT_ATTACHED : SHORT_NEXT;
+    }
+    if (p[1] == '\0') {
+        return SHORT_FLAG;
+    }
+    return rules_is_short_name(p[1]) ? SHORT_CLUSTER : SHORT_NOT_ALLOWED;
+}
+
+/*
+ * Prints diagnostic of option c unless silent and returns its code: '?', or
+ * ':' for a missing argument (SHORT_NEXT at the end of argv) when silent.
+ */
+static inline int rules_error(const struct rules *rules, enum short_option kind, char c) {
+    if (kind == SHORT_NEXT) {
+        if (!rules->silent) {
+            fprintf(stderr, "Option -%c requires an argument.\n", c);
+        }
+        return rules->silent ? ':' : '?';
+    }
+
+    if (!rules->silent) {
+        if (kind == SHORT_NOT_ALLOWED) {
+            fprintf(stderr, "Option -%c doesn't allow an argument.\n", c);
+        } else {
+            fprintf(stderr, "Unknown option: -%c\n", c); // TODO: utf8
+        }
+    }
+
+    return '?';
+}
+
+#endif /* RULES_H */
@@ -1,13 +1,50 @@
 LIB = lib/libutils.a
 
 HDRS = \
-	include/utils.h
+	include/utils.h \
+	include/utils.hpp
 
 SRCS = \
-	source/getopt.c
+	source/cache.c \
+	source/complete.c \
+	source/getopt.c \
+	source/glob.c \
+	source/prefetch.c \
+	source/split.c \
+	source/step.c \
+	source/usage.c
+
+BINS = \
+	bin/optgen
+
+OPTSPECS = \
+	tests/test-optgen.opts \
+	tests/test-optgen-order.opts
 
 TESTSRCS = \
-	tests/test-getopt.c
+	tests/fuzz-getopt.c \
+	tests/test-cache.c \
+	tests/test-complete.c \
+	tests/test-getopt.c \
+	tests/test-glob.c \
+	tests/test-optgen.c \
+	tests/test-prefetch.c \
+	tests/test-split.c \
+	tests/test-step.c \
+	tests/test-usage.c \
+	tests/test-utils.cpp
+
+BENCHSRCS = \
+	tests/bench-getopt.c
+
+FUZZSRCS = \
+	tests/fuzz-getopt.c
+
+COUNTSRCS = \
+	source/getopt.c
 
 CFLAGS += \
-	-Iinclude -I$(libutf8_INCLUDE) -D_POSIX_C_SOURCE=200809L
+	-Iinclude -I$(libutf8_INCLUDE) -D_POSIX_C_SOURCE=200809L -pthread
+
+CXXFLAGS += \
+	-Iinclude -I$(libutf8_INCLUDE) -pthread
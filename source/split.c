@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+    #include <immintrin.h>
+#endif
+
+#include <flos/utils.h>
+
+#define ONES  0x0101010101010101ULL
+#define HIGHS 0x8080808080808080ULL
+
+static int is_in(const char *set, size_t n, char c) {
+    for (size_t i = 0; i < n; i++) {
+        if (set[i] == c) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// Whether any byte of word is zero
+static uint64_t has_zero(uint64_t x) {
+    return (x - ONES) & ~x & HIGHS;
+}
+
+static int count_trailing_zeros(unsigned x) {
+#if defined(__GNUC__)
+    return __builtin_ctz(x);
+#else
+    int n = 0;
+
+    while (!(x & 1)) {
+        x >>= 1;
+        n++;
+    }
+
+    return n;
+#endif
+}
+
+// Fills each block of repeated with a byte of set, so it is compared with a block of input at once
+static void repeat(unsigned char repeated[][UTILS_SPLIT_BLOCK], const char *set, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        memset(repeated[i], (unsigned char)set[i], UTILS_SPLIT_BLOCK);
+    }
+}
+
+/*
+ * Returns first byte of [p, end) that is in set, or end. Whole blocks are
+ * compared against every byte of the set, repeated over a block by repeat(),
+ * at once, and only a block with a match is looked at byte by byte.
+ */
+static const char *find(const char *p, const char *end, const char *set, size_t n, const unsigned char *repeated) {
+#if defined(__SSE2__)
+    for (; end - p >= 16; p += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)p);
+        __m128i hits = _mm_setzero_si128();
+
+        for (size_t i = 0; i < n; i++) {
+            __m128i separator = _mm_loadu_si128((const __m128i *)(repeated + i * UTILS_SPLIT_BLOCK));
+
+            hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, separator));
+        }
+
+        unsigned mask = (unsigned)_mm_movemask_epi8(hits);
+
+        if (mask != 0) {
+            return p + count_trailing_zeros(mask);
+        }
+    }
+#endif
+
+    for (; end - p >= 8; p += 8) {
+        uint64_t block, word, hits = 0;
+
+        memcpy(&block, p, sizeof(block));
+
+        for (size_t i = 0; i < n; i++) {
+            memcpy(&word, repeated + i * UTILS_SPLIT_BLOCK, sizeof(word));
+            hits |= has_zero(block ^ word);
+        }
+
+        if (hits != 0) {
+            break; // byte order does not matter when found byte by byte
+        }
+    }
+
+    for (; p < end; p++) {
+        if (is_in(set, n, *p)) {
+            return p;
+        }
+    }
+
+    return end;
+}
+
+// Like find(), when set is too large to compare at once
+static const char *find_slow(const char *p, const char *end, const char *separators, char escape) {
+    for (; p < end; p++) {
+        if ((escape != '\0' && *p == escape) || strchr(separators, *p) != NULL) {
+            return p;
+        }
+    }
+
+    return end;
+}
+
+void utils_split_init(struct utils_splitter *splitter, const char *value, const char *separators, char escape) {
+    size_t n = strlen(separators);
+
+    splitter->next = value;
+    splitter->end = value + strlen(value);
+    splitter->separators = separators;
+    splitter->escape = escape;
+    splitter->nset = 0;
+
+    if (n + (escape != '\0') <= UTILS_SPLIT_MAX_SET) {
+        memcpy(splitter->set, separators, n);
+        if (escape != '\0') {
+            splitter->set[n++] = escape;
+        }
+        splitter->nset = n;
+        repeat(splitter->repeated, splitter->set, n);
+    }
+}
+
+int utils_split_next(struct utils_splitter *splitter, struct utils_span *item) {
+    const char *end = splitter->end;
+
+    while (splitter->next < end) {
+        const char *start = splitter->next;
+        const char *p = start;
+
+        for (;;) {
+            if (splitter->nset > 0) {
+                p = find(p, end, splitter->set, splitter->nset, splitter->repeated[0]);
+            } else {
+                p = find_slow(p, end, splitter->separators, splitter->escape);
+            }
+
+            if (p == end || splitter->escape == '\0' || *p != splitter->escape) {
+                break;
+            }
+
+            p += end - p > 1 ? 2 : 1; // escaped byte is part of item
+        }
+
+        splitter->next = p < end ? p + 1 : p;
+
+        if (p > start) {
+            item->ptr = start;
+            item->len = (size_t)(p - start);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int utils_split_pair(struct utils_span item, char assign, char escape, struct utils_span *key,
+                     struct utils_span *value) {
+    const char set[2] = {assign, escape};
+    size_t n = escape != '\0' ? 2 : 1;
+    unsigned char repeated[2][UTILS_SPLIT_BLOCK];
+    const char *end = item.ptr + item.len;
+    const char *p = item.ptr;
+
+    repeat(repeated, set, n);
+
+    for (;;) {
+        p = find(p, end, set, n, repeated[0]);
+
+        if (p == end || *p == assign) {
+            break;
+        }
+
+        p += end - p > 1 ? 2 : 1;
+    }
+
+    key->ptr = item.ptr;
+    key->len = (size_t)(p - item.ptr);
+
+    if (p == end) {
+        value->ptr = end;
+        value->len = 0;
+        return 0;
+    }
+
+    value->ptr = p + 1;
+    value->len = (size_t)(end - p - 1);
+
+    return 1;
+}
+
+size_t utils_unescape(struct utils_span span, char escape, char *out) {
+    size_t n = 0;
+
+    for (size_t i = 0; i < span.len; i++) {
+        if (escape != '\0' && span.ptr[i] == escape && i + 1 < span.len) {
+            i++;
+        }
+        out[n++] = span.ptr[i];
+    }
+    out[n] = '\0';
+
+    return n;
+}
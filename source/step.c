@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <time.h>
+
+#include <flos/utils.h>
+
+#include "rules.h"
+
+#define BLOCK 256 // options per block, so adding one never copies the others
+
+enum phase {
+    OPTIONS,    // words are parsed one by one
+    OPERANDS,   // every word left is an operand
+    COLLECTING, // options are copied from blocks into one array
+    FINISHED,
+    FAILED,
+};
+
+struct block {
+    struct block *next;
+    size_t count;
+    struct utils_parse_option options[BLOCK];
+};
+
+/*
+ * Whole state of the parse, so it can stop after any unit of work. Unlike
+ * utils_getopt() nothing is moved: operands are gathered into own array as
+ * they are found, and a cluster is continued from the saved character.
+ */
+struct utils_parser {
+    struct utils_parse parse;
+    char *const *argv;
+    int argc;
+    struct rules rules;
+    enum phase phase;
+    int index;           // next word of argv
+    const char *cluster; // next character of short option cluster, NULL between words
+    const char **operands;
+    struct utils_parse_option *options;
+    struct block *head, *tail; // options found, head is copied next when collecting
+    size_t collected;          // options of head copied
+};
+
+static int at_end(const struct utils_parser *parser) {
+    return parser->index >= parser->argc || parser->argv[parser->index] == NULL;
+}
+
+static int add(struct utils_parser *parser, utf8_char code, const char *optarg) {
+    struct block *b = parser->tail;
+
+    if (b == NULL || b->count == BLOCK) {
+        if ((b = malloc(sizeof(*b))) == NULL) {
+            return -1;
+        }
+        b->next = NULL;
+        b->count = 0;
+
+        if (parser->tail != NULL) {
+            parser->tail->next = b;
+        } else {
+            parser->head = b;
+        }
+        parser->tail = b;
+    }
+
+    b->options[b->count].code = code;
+    b->options[b->count].optarg = optarg;
+    b->count++;
+    parser->parse.noptions++;
+
+    return 0;
+}
+
+// Parses short option at p the way utils_getopt() does
+static int option(struct utils_parser *parser, const char *p) {
+    enum short_option kind = rules_short(&parser->rules, p);
+
+    parser->cluster = NULL;
+
+    switch (kind) {
+    case SHORT_ATTACHED:
+        return add(parser, *p, p + 1);
+    case SHORT_NEXT:
+        if (at_end(parser)) {
+            return add(parser, rules_error(&parser->rules, kind, *p), p);
+        }
+        return add(parser, *p, parser->argv[parser->index++]);
+    case SHORT_CLUSTER:
+        parser->cluster = p + 1;
+        return add(parser, *p, NULL);
+    case SHORT_FLAG:
+        return add(parser, *p, NULL);
+    case SHORT_UNKNOWN:
+        return add(parser, rules_error(&parser->rules, kind, *p), p);
+    default:
+        return add(parser, rules_error(&parser->rules, kind, *p), NULL);
+    }
+}
+
+static int parse_word(struct utils_parser *parser) {
+    if (parser->cluster != NULL) {
+        return option(parser, parser->cluster);
+    }
+
+    if (at_end(parser)) {
+        parser->phase = COLLECTING;
+        return 0;
+    }
+
+    const char *word = parser->argv[parser->index++];
+
+    switch (rules_word(word)) {
+    case WORD_END:
+        parser->phase = OPERANDS;
+        return 0;
+    case WORD_LONG:
+        return add(parser, 2, word + 3);
+    case WORD_DASH:
+        return add(parser, -1, NULL);
+    case WORD_SHORT:
+        return option(parser, word + 1);
+    default:
+        break;
+    }
+
+    switch (parser->rules.ordering) {
+    case REQUIRE_ORDER:
+        parser->index--;
+        parser->phase = OPERANDS;
+        return 0;
+    case RETURN_IN_ORDER:
+        return add(parser, 1, word);
+    default:
+        parser->operands[parser->parse.noperands++] = word;
+        return 0;
+    }
+}
+
+// Copies next option into result array, freeing blocks copied
+static int collect(struct utils_parser *parser) {
+    struct block *b = parser->head;
+
+    if (parser->options == NULL) {
+        size_t n = parser->parse.noptions;
+
+        if ((parser->options = malloc((n ? n : 1) * sizeof(*parser->options))) == NULL) {
+            return -1;
+        }
+        parser->parse.options = parser->options;
+        parser->parse.noptions = 0;
+    }
+
+    if (b == NULL) {
+        parser->phase = FINISHED;
+        return 0;
+    }
+
+    if (parser->collected < b->count) {
+        parser->options[parser->parse.noptions++] = b->options[parser->collected++];
+    }
+
+    if (parser->collected == b->count) {
+        parser->head = b->next;
+        parser->collected = 0;
+        free(b);
+    }
+
+    return 0;
+}
+
+// Does one unit of work, which takes time independent of argc
+static int advance(struct utils_parser *parser) {
+    switch (parser->phase) {
+    case OPTIONS:
+        return parse_word(parser);
+    case OPERANDS:
+        if (at_end(parser)) {
+            parser->phase = COLLECTING;
+        } else {
+            parser->operands[parser->parse.noperands++] = parser->argv[parser->index++];
+        }
+        return 0;
+    case COLLECTING:
+        return collect(parser);
+    default:
+        return 0;
+    }
+}
+
+static long elapsed(const struct timespec *start) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec - start->tv_sec) * 1000000000L + (now.tv_nsec - start->tv_nsec);
+}
+
+struct utils_parser *utils_parser_create(int argc, char *const argv[], const char *opts) {
+    struct utils_parser *parser = calloc(1, sizeof(*parser));
+
+    if (argv == NULL || opts == NULL || argc <= 0 || argv[0] == NULL) {
+        argc = 0;
+    }
+
+    if (parser == NULL || (parser->operands = malloc((argc > 0 ? argc : 1) * sizeof(char *))) == NULL) {
+        free(parser);
+        return NULL;
+    }
+
+    parser->argv = argv;
+    parser->argc = argc;
+    parser->index = 1; // argv[0] is the program
+    parser->parse.operands = parser->operands;
+
+    rules_init(&parser->rules, opts != NULL ? opts : "");
+
+    return parser;
+}
+
+enum utils_step utils_parser_step(struct utils_parser *parser, const struct utils_budget *budget) {
+    size_t max_units = budget != NULL ? budget->max_units : 0;
+    long max_nanoseconds = budget != NULL ? budget->max_nanoseconds : 0;
+    struct timespec start;
+    size_t units = 0;
+
+    if (max_nanoseconds > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+    }
+
+    while (parser->phase < FINISHED) {
+        // Every step does at least one unit, so the parse always gets done
+        if (units > 0 && max_units > 0 && units >= max_units) {
+            return UTILS_STEP_MORE;
+        }
+        if (units > 0 && max_nanoseconds > 0 && units % UTILS_STEP_CHECK == 0 && elapsed(&start) >= max_nanoseconds) {
+            return UTILS_STEP_MORE;
+        }
+
+        if (advance(parser) != 0) {
+            parser->phase = FAILED;
+        }
+        units++;
+    }
+
+    return parser->phase == FINISHED ? UTILS_STEP_DONE : UTILS_STEP_ERROR;
+}
+
+const struct utils_parse *utils_parser_result(const struct utils_parser *parser) {
+    return parser->phase == FINISHED ? &parser->parse : NULL;
+}
+
+void utils_parser_destroy(struct utils_parser *parser) {
+    if (parser == NULL) {
+        return;
+    }
+
+    while (parser->head != NULL) {
+        struct block *next = parser->head->next;
+
+        free(parser->head);
+        parser->head = next;
+    }
+
+    free(parser->options);
+    free(parser->operands);
+    free(parser);
+}
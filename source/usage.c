@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include <flos/utils.h>
+
+#define INDENT    2 // spaces before option names
+#define GAP       2 // spaces between option names and description
+#define MAX_NAMES 30 // option names wider than this put description on next line
+
+// Appends n bytes to buffer; when buf is NULL only length is counted.
+static size_t put(char *buf, size_t pos, const char *s, size_t n) {
+    if (buf != NULL) {
+        memcpy(buf + pos, s, n);
+    }
+    return pos + n;
+}
+
+static size_t pad(char *buf, size_t pos, size_t n) {
+    if (buf != NULL) {
+        memset(buf + pos, ' ', n);
+    }
+    return pos + n;
+}
+
+// Renders "-a, --all=ARG" part of the option line.
+static size_t put_names(char *buf, size_t pos, const struct utils_option *o) {
+    if (o->short_name != '\0') {
+        char s[2] = {'-', o->short_name};
+        pos = put(buf, pos, s, 2);
+        if (o->long_name != NULL) {
+            pos = put(buf, pos, ", ", 2);
+        }
+    } else {
+        pos = pad(buf, pos, 4); // align long only options with the others
+    }
+
+    if (o->long_name != NULL) {
+        pos = put(buf, pos, "--", 2);
+        pos = put(buf, pos, o->long_name, strlen(o->long_name));
+    }
+
+    if (o->argument != UTILS_NO_ARGUMENT) {
+        const char *arg = o->arg_name != NULL ? o->arg_name : "ARG";
+
+        pos = put(buf, pos, o->long_name != NULL ? "=" : " ", 1);
+        pos = put(buf, pos, arg, strlen(arg));
+    }
+
+    return pos;
+}
+
+// Renders description wrapped at width, continuation lines are indented to column.
+static size_t put_help(char *buf, size_t pos, const char *help, size_t column, size_t width) {
+    size_t avail = width > column + 20 ? width - column : 20;
+    size_t used = 0;
+
+    while (*help != '\0') {
+        while (*help == ' ') {
+            help++;
+        }
+
+        size_t n = strcspn(help, " ");
+
+        if (n == 0) {
+            break;
+        }
+
+        if (used > 0 && used + 1 + n > avail) {
+            pos = put(buf, pos, "\n", 1);
+            pos = pad(buf, pos, column);
+            used = 0;
+        } else if (used > 0) {
+            pos = put(buf, pos, " ", 1);
+            used++;
+        }
+
+        pos = put(buf, pos, help, n);
+        used += n;
+        help += n;
+    }
+
+    return put(buf, pos, "\n", 1);
+}
+
+static size_t render(char *buf, const struct utils_option *options, size_t count, size_t column, size_t width) {
+    size_t pos = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const struct utils_option *o = &options[i];
+        size_t start = pos;
+
+        pos = pad(buf, pos, INDENT);
+        pos = put_names(buf, pos, o);
+
+        if (o->help == NULL || *o->help == '\0') {
+            pos = put(buf, pos, "\n", 1);
+            continue;
+        }
+
+        if (pos - start + GAP > column) {
+            pos = put(buf, pos, "\n", 1);
+            pos = pad(buf, pos, column);
+        } else {
+            pos = pad(buf, pos, column - (pos - start));
+        }
+
+        pos = put_help(buf, pos, o->help, column, width);
+    }
+
+    return pos;
+}
+
+int utils_usage(int fd, const char *synopsis, const struct utils_option *options, size_t count, size_t width) {
+    size_t column = 0;
+
+    if (width == 0) {
+        width = UTILS_USAGE_WIDTH;
+    }
+
+    // Column of descriptions is the widest option names that fits in MAX_NAMES
+    for (size_t i = 0; i < count; i++) {
+        size_t n = INDENT + put_names(NULL, 0, &options[i]);
+
+        if (n <= MAX_NAMES && n > column) {
+            column = n;
+        }
+    }
+    column += GAP;
+
+    size_t len = render(NULL, options, count, column, width);
+    char *body = malloc(len + 1);
+
+    if (body == NULL) {
+        return -1;
+    }
+
+    render(body, options, count, column, width);
+
+    struct iovec iov[4] = {
+        {"Usage: ", 7},
+        {(void *)synopsis, synopsis != NULL ? strlen(synopsis) : 0},
+        {"\n\n", 2},
+        {body, len},
+    };
+    struct iovec *v = synopsis != NULL ? iov : iov + 3;
+    int vcnt = synopsis != NULL ? 4 : 1;
+
+    while (vcnt > 0) {
+        ssize_t n = writev(fd, v, vcnt);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            free(body);
+            return -1;
+        }
+
+        // Partial write: skip what was written and continue with the rest
+        while (vcnt > 0 && (size_t)n >= v->iov_len) {
+            n -= v->iov_len;
+            v++;
+            vcnt--;
+        }
+        if (vcnt > 0) {
+            v->iov_base = (char *)v->iov_base + n;
+            v->iov_len -= n;
+        }
+    }
+
+    free(body);
+
+    return 0;
+}
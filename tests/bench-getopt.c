@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Benchmarks of stepping over operand runs, parsing of large argv and
+ * splitting of long list arguments. Configure with optimization (e.g.
+ * CFLAGS="-O2" ./configure) before "make bench".
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <flos/utf8.h>
+#include <flos/utils.h>
+
+#if defined(__SSE2__)
+    #include <immintrin.h>
+#endif
+
+#define COUNT  200000
+#define ROUNDS 20
+#define CHUNK  64 // words classified at once by operand_run_chunked()
+
+static char *args[COUNT + 1];
+static char *work[COUNT + 1];
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, double seconds, size_t count) {
+    printf("%-36s %8.2f ns/arg\n", name, seconds * 1e9 / count);
+}
+
+// Fills args with operands and given percentage of randomly placed options
+static int make_args(int count, int percent) {
+    srand(1);
+
+    args[0] = "program";
+    for (int i = 1; i < count; i++) {
+        char buf[32];
+
+        if (rand() % 100 < percent) {
+            snprintf(buf, sizeof(buf), rand() % 2 ? "-a" : "--all");
+        } else {
+            snprintf(buf, sizeof(buf), "file-%d.txt", i);
+        }
+        free(args[i]);
+        args[i] = strdup(buf);
+    }
+    args[count] = NULL;
+
+    return count;
+}
+
+// Returns number of operands argv[0..count) starts with, reading one word after another as partition() does
+static size_t operand_run(char *const argv[], size_t count) {
+    size_t i = 0;
+
+    while (i < count && argv[i][0] != '-') {
+        i++;
+    }
+
+    return i;
+}
+
+// Returns bit i set when argv[i] of n <= CHUNK words is not an operand, comparing gathered leading bytes at once
+static uint64_t classify_chunk(char *const argv[], size_t n) {
+    unsigned char first[CHUNK];
+    uint64_t options = 0;
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        first[i] = (unsigned char)argv[i][0];
+    }
+    for (; i < CHUNK; i++) {
+        first[i] = '-'; // padding ends the run
+    }
+
+#if defined(__SSE2__)
+    for (i = 0; i < CHUNK; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(first + i));
+
+        options |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('-'))) << i;
+    }
+#else
+    for (i = 0; i < CHUNK; i++) {
+        options |= (uint64_t)(first[i] == '-') << i;
+    }
+#endif
+
+    return options;
+}
+
+// Same as operand_run() with argv classified by chunks into a bitmap first
+static size_t operand_run_chunked(char *const argv[], size_t count) {
+    for (size_t i = 0; i < count; i += CHUNK) {
+        uint64_t options = classify_chunk(argv + i, count - i < CHUNK ? count - i : CHUNK);
+
+        if (options != 0) {
+            size_t n = 0;
+
+            while (!(options & 1)) {
+                options >>= 1;
+                n++;
+            }
+
+            return i + n < count ? i + n : count;
+        }
+    }
+
+    return count;
+}
+
+// Steps over args by operand runs and single options, as partition() does, with and without a classification pass
+static void bench_runs(const char *name, int count) {
+    volatile size_t sink = 0;
+    char title[64];
+    double t;
+
+    t = now();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (size_t i = 1, run; i < (size_t)count; i += run > 0 ? run : 1, sink++) {
+            run = operand_run(args + i, (size_t)count - i);
+        }
+    }
+    snprintf(title, sizeof(title), "operand runs, %s", name);
+    report(title, now() - t, (size_t)count * ROUNDS);
+
+    t = now();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (size_t i = 1, run; i < (size_t)count; i += run > 0 ? run : 1, sink++) {
+            run = operand_run_chunked(args + i, (size_t)count - i);
+        }
+    }
+    snprintf(title, sizeof(title), "operand runs by chunks, %s", name);
+    report(title, now() - t, (size_t)count * ROUNDS);
+}
+
+static void bench_getopt(const char *name, int count) {
+    double t = now();
+
+    for (int r = 0; r < ROUNDS; r++) {
+        int argc = count;
+        char **argv = work;
+        char *optarg = NULL;
+
+        memcpy(work, args, (count + 1) * sizeof(*args));
+
+        while (utils_getopt(&argc, &argv, &optarg, "a")) {
+        }
+    }
+
+    report(name, now() - t, (size_t)count * ROUNDS);
+}
+
+// Splits a long list argument with strtok() over a copy and with utils_split_next()
+static void bench_split(size_t length, size_t item) {
+    char *value = malloc(length + 1);
+    char *copy = malloc(length + 1);
+    volatile size_t sink = 0;
+    struct utils_splitter s;
+    struct utils_span span;
+    char title[64];
+    double t;
+
+    for (size_t i = 0; i < length; i++) {
+        value[i] = i % item == item - 1 ? ',' : 'a' + i % 26;
+    }
+    value[length] = '\0';
+
+    t = now();
+    for (int r = 0; r < ROUNDS; r++) {
+        memcpy(copy, value, length + 1);
+        for (char *tok = strtok(copy, ","); tok != NULL; tok = strtok(NULL, ",")) {
+            sink += (size_t)*tok;
+        }
+    }
+    snprintf(title, sizeof(title), "strtok, %zu byte items", item);
+    printf("%-36s %8.2f ns/byte\n", title, (now() - t) * 1e9 / ((double)length * ROUNDS));
+
+    t = now();
+    for (int r = 0; r < ROUNDS; r++) {
+        utils_split_init(&s, value, ",", '\\');
+        while (utils_split_next(&s, &span)) {
+            sink += span.len;
+        }
+    }
+    snprintf(title, sizeof(title), "utils_split_next, %zu byte items", item);
+    printf("%-36s %8.2f ns/byte\n", title, (now() - t) * 1e9 / ((double)length * ROUNDS));
+
+    free(value);
+    free(copy);
+}
+
+int main(void) {
+    int count = make_args(COUNT, 0);
+    bench_runs("no options", count);
+    bench_getopt("utils_getopt, no options", count);
+
+    count = make_args(COUNT, 1);
+    bench_runs("1% options", count);
+    bench_getopt("utils_getopt, 1% options", count);
+
+    count = make_args(COUNT, 10);
+    bench_runs("10% options", count);
+    bench_getopt("utils_getopt, 10% options", count);
+
+    bench_split(500000, 8);
+    bench_split(500000, 64);
+
+    return 0;
+}
@@ -0,0 +1,291 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Worst-case cost harness for utils_getopt(). An input is decoded into an opts
+ * spec and a shape of argv, which is parsed repeated 2 and 16 times. Writes
+ * of argv[] elements are counted by a build of getopt.c with
+ * UTILS_COUNT_WRITES, so the verdict does not depend on timing and catches
+ * work that leaves argv as it was; an input whose cost grows more than twice
+ * as fast as argv is super-linear.
+ *
+ * Built with -DFUZZING it is a libFuzzer target ("make fuzz"), which aborts
+ * on super-linear inputs. Otherwise it replays files given as arguments,
+ * printing cost and time, and aborts on super-linear ones, so AFL can run it
+ * as "afl-fuzz -i tests/corpus/getopt -o out -- build/fuzz-getopt @@".
+ * Without arguments it checks regression corpus in tests/corpus/getopt.
+ */
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <flos/utf8.h>
+#include <flos/utils.h>
+
+#define CORPUS     "tests/corpus/getopt"
+#define MAX_INPUT  4096
+#define MAX_WORDS  MAX_INPUT
+#define SMALL      2
+#define LARGE      16
+#define MAX_GROWTH 2 // allowed growth of cost per argument from SMALL to LARGE
+
+struct shape {
+    char opts[32];
+    char letters[8];
+    size_t nletters;
+    size_t nwords;
+    char words[MAX_WORDS][8];
+};
+
+struct cost {
+    size_t args;
+    size_t writes;
+    double seconds;
+};
+
+extern size_t utils_getopt_writes; // defined by getopt.c built with UTILS_COUNT_WRITES
+
+static struct shape shape;
+static char *args[LARGE * MAX_WORDS + 2];
+static char strings[LARGE * MAX_WORDS][8];
+
+/*
+ * First byte selects ordering prefix of opts, second number of options, each
+ * next byte of them an option letter, the high bit meaning it takes an
+ * argument. Every other byte is a word of argv.
+ */
+static void decode(const uint8_t *data, size_t size) {
+    size_t n = 0, i = 0;
+
+    memset(&shape, 0, sizeof(shape));
+
+    if (size > 0) {
+        if ((data[0] & 3) == 1) {
+            shape.opts[n++] = '+';
+        } else if ((data[0] & 3) == 2) {
+            shape.opts[n++] = '-';
+        }
+        i++;
+    }
+    shape.opts[n++] = ':'; // diagnostics would only slow it down
+
+    if (i < size) {
+        size_t count = 1 + data[i++] % (sizeof(shape.letters) - 1);
+
+        for (; count > 0 && i < size; count--, i++) {
+            char c = 'a' + data[i] % 26;
+
+            shape.letters[shape.nletters++] = c;
+            shape.opts[n++] = c;
+            if (data[i] & 0x80) {
+                shape.opts[n++] = ':';
+            }
+        }
+    }
+
+    if (shape.nletters == 0) {
+        shape.letters[shape.nletters++] = 'a';
+        shape.opts[n++] = 'a';
+    }
+
+    for (; i < size && shape.nwords < MAX_WORDS; i++) {
+        char *w = shape.words[shape.nwords++];
+        char c = shape.letters[(data[i] >> 3) % shape.nletters];
+        char d = shape.letters[(data[i] >> 5) % shape.nletters];
+
+        switch (data[i] % 8) {
+        case 0:
+        case 1:
+            strcpy(w, "file");
+            break;
+        case 2:
+            snprintf(w, 8, "-%c", c);
+            break;
+        case 3:
+            snprintf(w, 8, "-%c%c", c, d);
+            break;
+        case 4:
+            snprintf(w, 8, "-%cval", c);
+            break;
+        case 5:
+            strcpy(w, "--");
+            break;
+        case 6:
+            strcpy(w, "-");
+            break;
+        default:
+            strcpy(w, data[i] & 0x80 ? "--name" : "-9");
+            break;
+        }
+    }
+}
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Fills args with shape repeated given times and returns their number
+static size_t fill(size_t repeat) {
+    size_t n = 0;
+
+    args[0] = "fuzz";
+    for (size_t r = 0; r < repeat; r++) {
+        for (size_t i = 0; i < shape.nwords; i++, n++) {
+            memcpy(strings[n], shape.words[i], sizeof(strings[n]));
+            args[n + 1] = strings[n];
+        }
+    }
+    args[n + 1] = NULL;
+
+    return n + 1;
+}
+
+// Parses shape repeated given times, as utils_getopt() callers do
+static struct cost measure(size_t repeat) {
+    struct cost cost = {fill(repeat), 0, 0};
+    int argc = (int)cost.args;
+    char **av = args;
+    char *optarg = NULL;
+
+    utils_getopt_writes = 0;
+    cost.seconds = now();
+    while (utils_getopt(&argc, &av, &optarg, shape.opts) != 0) {
+    }
+    cost.seconds = now() - cost.seconds;
+    cost.writes = utils_getopt_writes;
+
+    return cost;
+}
+
+// Cost per argument may grow by constant factor from SMALL to LARGE, not with argv length
+static int is_super_linear(const struct cost *small, const struct cost *large) {
+    double per_small = (double)(small->writes + small->args) / small->args;
+    double per_large = (double)(large->writes + large->args) / large->args;
+
+    return per_large > per_small * MAX_GROWTH;
+}
+
+static int check(const uint8_t *data, size_t size, const char *name) {
+    struct cost small, large;
+    int bad;
+
+    decode(data, size);
+    small = measure(SMALL);
+    large = measure(LARGE);
+    bad = is_super_linear(&small, &large);
+
+    if (name != NULL) {
+        printf("# %s: opts \"%s\", %zu/%zu args, %zu/%zu writes, %.0f/%.0f ns%s\n", name, shape.opts, small.args,
+               large.args, small.writes, large.writes, small.seconds * 1e9, large.seconds * 1e9,
+               bad ? ", super-linear" : "");
+    }
+
+    return bad;
+}
+
+#ifdef FUZZING
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size <= MAX_INPUT && check(data, size, NULL)) {
+        abort(); // keep the input as a finding
+    }
+
+    return 0;
+}
+
+#else
+
+#include "tap.h"
+
+static size_t load(const char *path, uint8_t *data) {
+    FILE *f = fopen(path, "rb");
+    size_t size;
+
+    if (f == NULL) {
+        return 0;
+    }
+
+    size = fread(data, 1, MAX_INPUT, f);
+    fclose(f);
+
+    return size;
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Checks every input of regression corpus, in order of names
+static int run_corpus(void) {
+    static uint8_t data[MAX_INPUT];
+    static char *names[1024];
+    size_t count = 0;
+    struct dirent *d;
+    DIR *dir = opendir(CORPUS);
+
+    if (dir == NULL) {
+        bail_out("cannot open " CORPUS);
+    }
+
+    while ((d = readdir(dir)) != NULL && count < sizeof(names) / sizeof(names[0])) {
+        if (d->d_name[0] != '.') {
+            names[count++] = strdup(d->d_name);
+        }
+    }
+    closedir(dir);
+
+    qsort(names, count, sizeof(*names), compare_names);
+    plan((int)count);
+
+    for (size_t i = 0; i < count; i++) {
+        char path[512];
+
+        snprintf(path, sizeof(path), "%s/%s", CORPUS, names[i]);
+        ok(!check(data, load(path, data), names[i]), names[i]);
+        free(names[i]);
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    static uint8_t data[MAX_INPUT];
+
+    unsetenv("POSIXLY_CORRECT");
+
+    if (argc < 2) {
+        return run_corpus();
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (check(data, load(argv[i], data), argv[i])) {
+            abort();
+        }
+    }
+
+    return 0;
+}
+
+#endif
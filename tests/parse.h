@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Helpers of tests comparing a parser with utils_getopt() over the same
+ * words, usable from C and C++.
+ */
+
+#ifndef PARSE_H
+#define PARSE_H
+
+#include <stdio.h>
+#include <string.h>
+
+#include <flos/utf8.h>
+#include <flos/utils.h>
+
+#define PARSE_MAX_WORDS 32
+#define PARSE_BUFFER    1024
+
+// Copy of argv a parser may modify
+struct words {
+    int argc;
+    char *argv[PARSE_MAX_WORDS + 1];
+    char buf[PARSE_BUFFER];
+};
+
+// Options and operands returned by a parser, pointing into its words
+struct parse_result {
+    struct words words;
+    int count;
+    utf8_char codes[PARSE_MAX_WORDS];
+    const char *optargs[PARSE_MAX_WORDS];
+    int argc;
+    const char *operands[PARSE_MAX_WORDS];
+};
+
+typedef utf8_char (*getopt_function)(int *argc, char **argv[], char **optarg);
+
+static inline int copy_words(struct words *w, int argc, char *const argv[]) {
+    size_t used = 0;
+
+    w->argc = 0;
+    for (int i = 0; i < argc && i < PARSE_MAX_WORDS; i++) {
+        size_t len = strlen(argv[i]) + 1;
+
+        if (used + len > sizeof(w->buf)) {
+            break;
+        }
+
+        memcpy(w->buf + used, argv[i], len);
+        w->argv[w->argc++] = w->buf + used;
+        used += len;
+    }
+    w->argv[w->argc] = NULL;
+
+    return w->argc;
+}
+
+// Splits args at spaces
+static inline int split_words(struct words *w, const char *args) {
+    char copy[PARSE_BUFFER];
+    char *argv[PARSE_MAX_WORDS];
+    int argc = 0;
+
+    snprintf(copy, sizeof(copy), "%s", args);
+    for (char *tok = strtok(copy, " "); tok != NULL && argc < PARSE_MAX_WORDS; tok = strtok(NULL, " ")) {
+        argv[argc++] = tok;
+    }
+
+    return copy_words(w, argc, argv);
+}
+
+// Parses words of r with utils_getopt() and opts, or with parse when opts is NULL
+static inline void parse_words(struct parse_result *r, const char *opts, getopt_function parse) {
+    char **argv = r->words.argv;
+    int argc = r->words.argc;
+    char *optarg = NULL;
+    utf8_char c;
+
+    r->count = 0;
+
+    while (r->count < PARSE_MAX_WORDS &&
+           (c = opts != NULL ? utils_getopt(&argc, &argv, &optarg, opts) : parse(&argc, &argv, &optarg)) != 0) {
+        r->codes[r->count] = c;
+        r->optargs[r->count] = optarg;
+        r->count++;
+    }
+
+    r->argc = argc;
+    for (int i = 0; i < argc && i < PARSE_MAX_WORDS; i++) {
+        r->operands[i] = argv[i];
+    }
+}
+
+static inline void parse_args(struct parse_result *r, const char *args, const char *opts, getopt_function parse) {
+    split_words(&r->words, args);
+    parse_words(r, opts, parse);
+}
+
+static inline int same_string(const char *a, const char *b) {
+    return a == b || (a != NULL && b != NULL && strcmp(a, b) == 0);
+}
+
+static inline int same_result(const struct parse_result *a, const struct parse_result *b) {
+    if (a->count != b->count || a->argc != b->argc) {
+        return 0;
+    }
+
+    for (int i = 0; i < a->count; i++) {
+        if (a->codes[i] != b->codes[i] || !same_string(a->optargs[i], b->optargs[i])) {
+            return 0;
+        }
+    }
+
+    for (int i = 0; i < a->argc && i < PARSE_MAX_WORDS; i++) {
+        if (!same_string(a->operands[i], b->operands[i])) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// Compares result of utils_getopt() with a parse not modifying argv
+static inline int same_parse(const struct parse_result *r, const struct utils_parse *parse) {
+    if (parse == NULL || (size_t)r->count != parse->noptions || (size_t)r->argc != parse->noperands) {
+        return 0;
+    }
+
+    for (int i = 0; i < r->count; i++) {
+        if (r->codes[i] != parse->options[i].code || !same_string(r->optargs[i], parse->options[i].optarg)) {
+            return 0;
+        }
+    }
+
+    for (int i = 0; i < r->argc && i < PARSE_MAX_WORDS; i++) {
+        if (!same_string(r->operands[i], parse->operands[i])) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+#endif /* PARSE_H */
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <flos/utf8.h>
+#include <flos/utils.h>
+
+#include "tap.h"
+
+#define THREADS 4
+
+static struct utils_parse_cache *cache;
+
+static void test_parse(void) {
+    char a[] = "-ab", p[] = "-pfoo";
+    char *argv[] = {"cc", "in.c", a, p, "out", NULL};
+    struct utils_parse_cache_stats stats;
+    const struct utils_parse *r1, *r2;
+
+    r1 = utils_parse_cached(cache, 5, argv, "abp:");
+    ok(r1 != NULL && r1->noptions == 3, "options are parsed");
+    ok(r1->options[0].code == 'a' && r1->options[1].code == 'b' && r1->options[2].code == 'p' &&
+           strcmp(r1->options[2].optarg, "foo") == 0,
+       "option codes and arguments");
+    ok(r1->noperands == 2 && strcmp(r1->operands[0], "in.c") == 0 && strcmp(r1->operands[1], "out") == 0,
+       "operands are kept");
+    ok(strcmp(argv[2], "-ab") == 0 && strcmp(argv[1], "in.c") == 0, "argv is not modified");
+
+    argv[0] = "other";
+    r2 = utils_parse_cached(cache, 5, argv, "abp:");
+    ok(r2 == r1, "same arguments share cached result");
+
+    utils_parse_cache_get_stats(cache, &stats);
+    ok(stats.hits == 1 && stats.misses == 1 && stats.entries == 1 && stats.bytes > 0, "hit and miss are counted");
+
+    r2 = utils_parse_cached(cache, 5, argv, "ab:p:");
+    ok(r2 != r1 && r2->noptions == 2 && strcmp(r2->options[1].optarg, "-pfoo") == 0, "opts are part of the key");
+
+    char *cluster[] = {"prog", "-abcdefgh", NULL};
+    const struct utils_parse *r3 = utils_parse_cached(cache, 2, cluster, "abcdefgh");
+    ok(r3 != NULL && r3->noptions == 8 && r3->options[7].code == 'h', "more options than arguments");
+    utils_parse_release(r3);
+
+    utils_parse_release(r1);
+    utils_parse_release(r1);
+    utils_parse_release(r2);
+}
+
+static void test_posixly_correct(void) {
+    char *argv[] = {"prog", "in", "-a", NULL};
+    const struct utils_parse *permuted, *ordered;
+
+    permuted = utils_parse_cached(cache, 3, argv, "a");
+    setenv("POSIXLY_CORRECT", "1", 1);
+    ordered = utils_parse_cached(cache, 3, argv, "a");
+    unsetenv("POSIXLY_CORRECT");
+
+    ok(permuted->noptions == 1 && permuted->noperands == 1 && ordered->noptions == 0 && ordered->noperands == 2,
+       "POSIXLY_CORRECT is part of the key");
+
+    utils_parse_release(permuted);
+    utils_parse_release(ordered);
+}
+
+static void test_eviction(void) {
+    struct utils_parse_cache *small = utils_parse_cache_create(2048, 1);
+    struct utils_parse_cache_stats stats;
+    const struct utils_parse *first;
+    char buf[32];
+    char *argv[] = {"prog", "-a", buf, NULL};
+
+    snprintf(buf, sizeof(buf), "file-0");
+    first = utils_parse_cached(small, 3, argv, "a");
+
+    for (int i = 1; i < 100; i++) {
+        snprintf(buf, sizeof(buf), "file-%d", i);
+        utils_parse_release(utils_parse_cached(small, 3, argv, "a"));
+    }
+
+    utils_parse_cache_get_stats(small, &stats);
+    ok(stats.evictions > 0 && stats.bytes <= 2048 + 4096, "cache stays within its limit");
+    ok(strcmp(first->operands[0], "file-0") == 0, "evicted result stays valid while referenced");
+
+    utils_parse_release(first);
+    utils_parse_cache_destroy(small);
+}
+
+static void test_release_after_destroy(void) {
+    struct utils_parse_cache *small = utils_parse_cache_create(2048, 1);
+    char buf[32];
+    char *argv[] = {"prog", buf, NULL};
+    const struct utils_parse *evicted, *cached, *large;
+
+    snprintf(buf, sizeof(buf), "evicted");
+    evicted = utils_parse_cached(small, 2, argv, "a");
+
+    for (int i = 0; i < 100; i++) {
+        snprintf(buf, sizeof(buf), "file-%d", i);
+        utils_parse_release(utils_parse_cached(small, 2, argv, "a"));
+    }
+
+    snprintf(buf, sizeof(buf), "cached");
+    cached = utils_parse_cached(small, 2, argv, "a");
+
+    char *long_argv[] = {"prog", "-a", buf, NULL};
+    memset(buf, 'x', sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    struct utils_parse_cache *tiny = utils_parse_cache_create(16, 1);
+    large = utils_parse_cached(tiny, 3, long_argv, "a");
+
+    utils_parse_cache_destroy(small);
+    utils_parse_cache_destroy(tiny);
+
+    ok(strcmp(evicted->operands[0], "evicted") == 0 && strcmp(cached->operands[0], "cached") == 0 &&
+           large->noptions == 1 && strlen(large->operands[0]) == sizeof(buf) - 1,
+       "results stay valid after cache is destroyed");
+
+    utils_parse_release(evicted);
+    utils_parse_release(cached);
+    utils_parse_release(large);
+}
+
+static void *reader(void *arg) {
+    char name[16];
+    char *argv[] = {"prog", "-a", name, NULL};
+    long bad = 0;
+
+    (void)arg;
+
+    for (int i = 0; i < 10000; i++) {
+        snprintf(name, sizeof(name), "f%d", i % 50);
+
+        const struct utils_parse *r = utils_parse_cached(cache, 3, argv, "a");
+
+        bad += r == NULL || r->noptions != 1 || strcmp(r->operands[0], name) != 0;
+        utils_parse_release(r);
+    }
+
+    return (void *)bad;
+}
+
+static void test_threads(void) {
+    pthread_t threads[THREADS];
+    struct utils_parse_cache_stats stats;
+    long bad = 0;
+
+    for (int i = 0; i < THREADS; i++) {
+        pthread_create(&threads[i], NULL, reader, NULL);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        void *r;
+
+        pthread_join(threads[i], &r);
+        bad += (long)r;
+    }
+
+    utils_parse_cache_get_stats(cache, &stats);
+    ok(bad == 0, "concurrent readers get correct results");
+    ok(stats.misses <= 2 + 50 * THREADS && stats.hits >= 40000 - 50 * THREADS, "concurrent readers hit the cache");
+}
+
+int main(void) {
+    plan(14);
+
+    if (freopen("/dev/null", "w", stderr) == NULL) {
+        bail_out("cannot redirect stderr");
+    }
+
+    if ((cache = utils_parse_cache_create(1 << 20, 8)) == NULL) {
+        bail_out("cannot create cache");
+    }
+
+    test_parse();
+    test_posixly_correct();
+    test_eviction();
+    test_release_after_destroy();
+    test_threads();
+
+    utils_parse_cache_destroy(cache);
+
+    return 0;
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <flos/utf8.h>
+#include <flos/utils.h>
+
+#include "tap.h"
+
+static const struct utils_option options[] = {
+    {'a', 'a', "all", UTILS_NO_ARGUMENT, NULL, "Show all entries"},
+    {'b', 'b', "brief", UTILS_NO_ARGUMENT, NULL, "Brief output"},
+    {'p', 'p', "print", UTILS_REQUIRED_ARGUMENT, "FILE", "Print to FILE"},
+    {0x103, '\0', "color", UTILS_REQUIRED_ARGUMENT, "WHEN", "Colorize output"},
+    {0x104, '\0', "colors", UTILS_NO_ARGUMENT, NULL, "List colors"},
+};
+
+#define COUNT (sizeof(options) / sizeof(options[0]))
+
+static const struct utils_option *matches[8];
+static size_t nmatches;
+
+static enum utils_completion complete_mode(char *argv[], int cursor, char mode) {
+    int argc = 0;
+
+    while (argv[argc] != NULL) {
+        argc++;
+    }
+
+    nmatches = sizeof(matches) / sizeof(matches[0]);
+
+    return utils_complete(argc, argv, cursor, mode, options, COUNT, matches, &nmatches);
+}
+
+static enum utils_completion complete(char *argv[], int cursor) {
+    return complete_mode(argv, cursor, '\0');
+}
+
+static void test_complete(void) {
+    {
+        char *argv[] = {"prog", "--co", NULL};
+        ok(complete(argv, 1) == UTILS_COMPLETE_OPTION && nmatches == 2 && matches[0] == &options[3] &&
+               matches[1] == &options[4],
+           "long options are matched by prefix");
+    }
+    {
+        char *argv[] = {"prog", "-", NULL};
+        ok(complete(argv, 1) == UTILS_COMPLETE_OPTION && nmatches == COUNT, "lone '-' matches every option");
+    }
+    {
+        char *argv[] = {"prog", "-ab", NULL};
+        ok(complete(argv, 1) == UTILS_COMPLETE_OPTION && nmatches == 1 && matches[0] == &options[1],
+           "short option cluster");
+    }
+    {
+        char *argv[] = {"prog", "-x", NULL};
+        ok(complete(argv, 1) == UTILS_COMPLETE_OPTION && nmatches == 0, "unknown short option");
+    }
+    {
+        char *argv[] = {"prog", "-ap", NULL};
+        ok(complete(argv, 2) == UTILS_COMPLETE_ARGUMENT && nmatches == 1 && matches[0] == &options[2],
+           "argument after short option cluster");
+    }
+    {
+        char *argv[] = {"prog", "-pfo", NULL};
+        ok(complete(argv, 1) == UTILS_COMPLETE_ARGUMENT && matches[0] == &options[2], "attached argument");
+    }
+    {
+        char *argv[] = {"prog", "--color=al", NULL};
+        ok(complete(argv, 1) == UTILS_COMPLETE_ARGUMENT && matches[0] == &options[3], "--name=value argument");
+    }
+    {
+        char *argv[] = {"prog", "--color", "", NULL};
+        ok(complete(argv, 2) == UTILS_COMPLETE_ARGUMENT && matches[0] == &options[3], "--name value argument");
+    }
+    {
+        char *argv[] = {"prog", "-p", "-a", "fi", NULL};
+        ok(complete(argv, 3) == UTILS_COMPLETE_OPERAND && nmatches == 0, "option argument is skipped");
+    }
+    {
+        char *argv[] = {"prog", "file", "--", "-a", NULL};
+        ok(complete(argv, 3) == UTILS_COMPLETE_OPERAND, "operands after '--'");
+    }
+    {
+        char *argv[] = {"prog", "file", "--b", NULL};
+        ok(complete(argv, 2) == UTILS_COMPLETE_OPTION && nmatches == 1 && matches[0] == &options[1],
+           "options after operands");
+    }
+    {
+        char *argv[] = {"prog", "-", NULL};
+        nmatches = 2;
+        ok(utils_complete(2, argv, 1, '\0', options, COUNT, matches, &nmatches) == UTILS_COMPLETE_OPTION &&
+               nmatches == COUNT,
+           "number of matches exceeding capacity is reported");
+    }
+}
+
+static void test_ordering(void) {
+    {
+        char *argv[] = {"prog", "file", "-a", NULL};
+        ok(complete_mode(argv, 2, '+') == UTILS_COMPLETE_OPERAND && nmatches == 0,
+           "'+' mode ends options at first operand");
+    }
+    {
+        char *argv[] = {"prog", "-p", "file", "-a", "--b", NULL};
+        ok(complete_mode(argv, 4, '+') == UTILS_COMPLETE_OPTION && nmatches == 1 && matches[0] == &options[1],
+           "'+' mode skips option arguments");
+    }
+    {
+        char *argv[] = {"prog", "file", "--b", NULL};
+        ok(complete_mode(argv, 2, '-') == UTILS_COMPLETE_OPTION && nmatches == 1 && matches[0] == &options[1],
+           "'-' mode keeps options after operands");
+    }
+    {
+        char *argv[] = {"prog", "file", "-a", NULL};
+
+        setenv("POSIXLY_CORRECT", "1", 1);
+        ok(complete(argv, 2) == UTILS_COMPLETE_OPERAND, "POSIXLY_CORRECT ends options at first operand");
+        unsetenv("POSIXLY_CORRECT");
+    }
+}
+
+#define BIG_COUNT 500
+
+static struct utils_option big[BIG_COUNT];
+static char names[BIG_COUNT][16];
+
+static void test_speed(void) {
+    static const struct utils_option *big_matches[BIG_COUNT];
+    char *argv[] = {"prog", "-a", "--option-1", "x", "--option-49", NULL};
+    struct timespec t0, t1;
+    size_t n = 0;
+
+    for (int i = 0; i < BIG_COUNT; i++) {
+        snprintf(names[i], sizeof(names[i]), "option-%d", i);
+        big[i] = (struct utils_option){0x100 + i, i < 26 ? 'a' + i : '\0', names[i], UTILS_NO_ARGUMENT, NULL, ""};
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < 1000; i++) {
+        n = BIG_COUNT;
+        utils_complete(5, argv, 4, '\0', big, BIG_COUNT, big_matches, &n);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    double us = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / 1e3 / 1000;
+    char msg[64];
+
+    snprintf(msg, sizeof(msg), "%.1f us per query over %d options", us, BIG_COUNT);
+    note(msg);
+
+    ok(n == 11, "prefix matches in large table");
+}
+
+int main(void) {
+    plan(17);
+
+    unsetenv("POSIXLY_CORRECT");
+
+    test_complete();
+    test_ordering();
+    test_speed();
+
+    return 0;
+}
@@ -23,6 +23,7 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -603,7 +604,7 @@ static void test_getopt(void) {
         ASSERT(argv[7] == NULL);
         ASSERT(a_seen == 0);
         ASSERT(b_seen == 0);
-        ASSERT(p_value == NULL);
+        ASSERT(p_value != NULL && strcmp(p_value, "billy") == 0);
         ASSERT(q_value == NULL);
         ASSERT(non_options_count == 0);
         ASSERT(unrecognized == 0);
@@ -656,7 +657,7 @@ static void test_getopt(void) {
         ASSERT(argv[12] == NULL);
         ASSERT(a_seen == 0);
         ASSERT(b_seen == 0);
-        ASSERT(p_value == NULL);
+        ASSERT(p_value != NULL && strcmp(p_value, "billy") == 0);
         ASSERT(q_value == NULL);
         ASSERT(non_options_count == 0);
         ASSERT(unrecognized == 0);
@@ -700,13 +701,141 @@ static void test_getopt(void) {
         ASSERT(argv[7] == NULL);
         ASSERT(a_seen == 0);
         ASSERT(b_seen == 0);
-        ASSERT(p_value == NULL);
+        ASSERT(p_value != NULL && strcmp(p_value, "billy") == 0);
         ASSERT(q_value == NULL);
         ASSERT(non_options_count == 0);
         ASSERT(unrecognized == 0);
         ASSERT(optind == 1);
         ASSERT(!output);
     }
+
+    /* Check that leading '-' returns operands in order as option 1.  */
+    for (start = OPTIND_MIN; start <= 1; start++) {
+        int a_seen = 0;
+        int b_seen = 0;
+        const char *p_value = NULL;
+        const char *q_value = NULL;
+        int non_options_count = 0;
+        const char *non_options[10];
+        int unrecognized = 0;
+        bool output;
+        int argc = 0;
+        char *argv[10];
+
+        argv[argc++] = strdup("program");
+        argv[argc++] = strdup("donald");
+        argv[argc++] = strdup("-p");
+        argv[argc++] = strdup("billy");
+        argv[argc++] = strdup("duck");
+        argv[argc++] = strdup("-a");
+        argv[argc++] = strdup("bar");
+        argv[argc] = NULL;
+        optind = start;
+
+        getopt_loop(argc, argv, "-abp:q:", &a_seen, &b_seen, &p_value, &q_value, &non_options_count, non_options,
+                    &unrecognized, &output);
+
+        ASSERT(strcmp(argv[0], "program") == 0);
+        ASSERT(strcmp(argv[1], "donald") == 0);
+        ASSERT(strcmp(argv[2], "-p") == 0);
+        ASSERT(strcmp(argv[3], "billy") == 0);
+        ASSERT(strcmp(argv[4], "duck") == 0);
+        ASSERT(strcmp(argv[5], "-a") == 0);
+        ASSERT(strcmp(argv[6], "bar") == 0);
+        ASSERT(a_seen == 1);
+        ASSERT(b_seen == 0);
+        ASSERT(p_value != NULL && strcmp(p_value, "billy") == 0);
+        ASSERT(q_value == NULL);
+        ASSERT(non_options_count == 3);
+        ASSERT(strcmp(non_options[0], "donald") == 0);
+        ASSERT(strcmp(non_options[1], "duck") == 0);
+        ASSERT(strcmp(non_options[2], "bar") == 0);
+        ASSERT(unrecognized == 0);
+    }
+
+    /* Check that leading '+' stops at the first operand.  */
+    for (start = OPTIND_MIN; start <= 1; start++) {
+        int a_seen = 0;
+        int b_seen = 0;
+        const char *p_value = NULL;
+        const char *q_value = NULL;
+        int non_options_count = 0;
+        const char *non_options[10];
+        int unrecognized = 0;
+        bool output;
+        int argc = 0;
+        char *argv[10];
+
+        argv[argc++] = strdup("program");
+        argv[argc++] = strdup("donald");
+        argv[argc++] = strdup("-p");
+        argv[argc++] = strdup("billy");
+        argv[argc++] = strdup("duck");
+        argv[argc++] = strdup("-a");
+        argv[argc++] = strdup("bar");
+        argv[argc] = NULL;
+        optind = start;
+
+        getopt_loop(argc, argv, "+abp:q:", &a_seen, &b_seen, &p_value, &q_value, &non_options_count, non_options,
+                    &unrecognized, &output);
+
+        ASSERT(strcmp(argv[0], "program") == 0);
+        ASSERT(strcmp(argv[1], "donald") == 0);
+        ASSERT(strcmp(argv[2], "-p") == 0);
+        ASSERT(strcmp(argv[3], "billy") == 0);
+        ASSERT(strcmp(argv[4], "duck") == 0);
+        ASSERT(strcmp(argv[5], "-a") == 0);
+        ASSERT(strcmp(argv[6], "bar") == 0);
+        ASSERT(a_seen == 0);
+        ASSERT(b_seen == 0);
+        ASSERT(p_value == NULL);
+        ASSERT(q_value == NULL);
+        ASSERT(non_options_count == 0);
+        ASSERT(unrecognized == 0);
+    }
+
+    /* Check that POSIXLY_CORRECT stops at the first operand.  */
+    for (start = OPTIND_MIN; start <= 1; start++) {
+        int a_seen = 0;
+        int b_seen = 0;
+        const char *p_value = NULL;
+        const char *q_value = NULL;
+        int non_options_count = 0;
+        const char *non_options[10];
+        int unrecognized = 0;
+        bool output;
+        int argc = 0;
+        char *argv[10];
+
+        argv[argc++] = strdup("program");
+        argv[argc++] = strdup("donald");
+        argv[argc++] = strdup("-p");
+        argv[argc++] = strdup("billy");
+        argv[argc++] = strdup("duck");
+        argv[argc++] = strdup("-a");
+        argv[argc++] = strdup("bar");
+        argv[argc] = NULL;
+        optind = start;
+
+        setenv("POSIXLY_CORRECT", "1", 1);
+        getopt_loop(argc, argv, "abp:q:", &a_seen, &b_seen, &p_value, &q_value, &non_options_count, non_options,
+                    &unrecognized, &output);
+        unsetenv("POSIXLY_CORRECT");
+
+        ASSERT(strcmp(argv[0], "program") == 0);
+        ASSERT(strcmp(argv[1], "donald") == 0);
+        ASSERT(strcmp(argv[2], "-p") == 0);
+        ASSERT(strcmp(argv[3], "billy") == 0);
+        ASSERT(strcmp(argv[4], "duck") == 0);
+        ASSERT(strcmp(argv[5], "-a") == 0);
+        ASSERT(strcmp(argv[6], "bar") == 0);
+        ASSERT(a_seen == 0);
+        ASSERT(b_seen == 0);
+        ASSERT(p_value == NULL);
+        ASSERT(q_value == NULL);
+        ASSERT(non_options_count == 0);
+        ASSERT(unrecognized == 0);
+    }
 }
 
 #define BACKUP_STDERR_FILENO 10
@@ -715,7 +844,7 @@ static void test_getopt(void) {
 static FILE *myerr;
 
 int main(void) {
-    plan(181);
+    plan(223);
 
     if (dup2(STDERR_FILENO, BACKUP_STDERR_FILENO) != BACKUP_STDERR_FILENO ||
         (myerr = fdopen(BACKUP_STDERR_FILENO, "w")) == NULL) {
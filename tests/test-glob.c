@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _XOPEN_SOURCE 700 // nftw() of tmpdir.h
+
+#include <fcntl.h>
+#include <glob.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <flos/utf8.h>
+#include <flos/utils.h>
+
+#include "tap.h"
+#include "tmpdir.h"
+
+static char root[TMPDIR_PATH];
+static char result[1 << 16];
+
+static void touch(const char *path) {
+    int fd = open(path, O_WRONLY | O_CREAT, 0644);
+
+    if (fd < 0) {
+        bail_out("cannot create test file");
+    }
+    close(fd);
+}
+
+static void make_tree(void) {
+    tmpdir_enter(root, "test-glob");
+
+    mkdir("a", 0755);
+    mkdir("a/b", 0755);
+    mkdir("a/b/c", 0755);
+    mkdir(".hidden", 0755);
+    touch("a/x.gz");
+    touch("a/y.txt");
+    touch("a/.h.gz");
+    touch("a/b/z.gz");
+    touch("a/b/c/w.gz");
+    touch(".hidden/q.gz");
+    symlink("..", "a/b/up"); // "**" must not follow it
+
+    mkdir("many", 0755);
+    for (int i = 0; i < 40; i++) {
+        char path[64];
+
+        snprintf(path, sizeof(path), "many/d%02d", i);
+        mkdir(path, 0755);
+        for (int j = 0; j < 25; j++) {
+            snprintf(path, sizeof(path), "many/d%02d/f%02d.%s", i, j, j % 3 ? "log" : "gz");
+            touch(path);
+        }
+    }
+}
+
+// Expands patterns into space separated list
+static const char *expand(unsigned threads, size_t count, char *patterns[]) {
+    struct utils_glob *glob = utils_glob_create(count, patterns, threads);
+    const char *path;
+    size_t n = 0;
+    int r;
+
+    result[0] = '\0';
+    while ((r = utils_glob_next(glob, &path)) == 1) {
+        n += snprintf(result + n, sizeof(result) - n, "%s%s", n ? " " : "", path);
+    }
+    utils_glob_destroy(glob);
+
+    return r == 0 ? result : "error";
+}
+
+static void check(const char *pattern, const char *expected) {
+    char *patterns[] = {(char *)pattern};
+    char name[128];
+    int good = 1;
+
+    for (unsigned threads = 0; threads <= 4; threads += 4) {
+        good = good && strcmp(expand(threads, 1, patterns), expected) == 0;
+    }
+
+    snprintf(name, sizeof(name), "%s expands to %s", pattern, expected);
+    ok(good, name);
+}
+
+static void test_patterns(void) {
+    check("a/*.gz", "a/x.gz");
+    check("*/*.gz", "a/x.gz");
+    check("a//*.gz", "a/x.gz");
+    check("a/**/*.gz", "a/x.gz a/b/z.gz a/b/c/w.gz");
+    check("a/**", "a/b a/x.gz a/y.txt a/b/c a/b/up a/b/z.gz a/b/c/w.gz");
+    check("*/b/*", "a/b/c a/b/up a/b/z.gz");
+    check("a/b/?/w.gz", "a/b/c/w.gz");
+    check("a/[xy].*", "a/x.gz a/y.txt");
+    check("a/.*.gz", "a/.h.gz");
+    check("a/*/up/x.gz", "a/b/up/x.gz");
+    check("nomatch*", "nomatch*");
+    check("plain", "plain");
+    check("a/b/*/missing", "a/b/*/missing");
+}
+
+static void test_order(void) {
+    char *patterns[] = {"many/d3*/f0[0-2].gz", "plain", "a/*.txt", "many/*/f24.*"};
+    char absolute[128];
+    char *paths[] = {absolute};
+    char expected[128];
+    int good = 1;
+
+    ok(strcmp(expand(3, 4, patterns),
+              "many/d30/f00.gz many/d31/f00.gz many/d32/f00.gz many/d33/f00.gz many/d34/f00.gz many/d35/f00.gz "
+              "many/d36/f00.gz many/d37/f00.gz many/d38/f00.gz many/d39/f00.gz plain a/y.txt many/d00/f24.gz "
+              "many/d01/f24.gz many/d02/f24.gz many/d03/f24.gz many/d04/f24.gz many/d05/f24.gz "
+              "many/d06/f24.gz many/d07/f24.gz many/d08/f24.gz many/d09/f24.gz many/d10/f24.gz "
+              "many/d11/f24.gz many/d12/f24.gz many/d13/f24.gz many/d14/f24.gz many/d15/f24.gz "
+              "many/d16/f24.gz many/d17/f24.gz many/d18/f24.gz many/d19/f24.gz many/d20/f24.gz "
+              "many/d21/f24.gz many/d22/f24.gz many/d23/f24.gz many/d24/f24.gz many/d25/f24.gz "
+              "many/d26/f24.gz many/d27/f24.gz many/d28/f24.gz many/d29/f24.gz many/d30/f24.gz "
+              "many/d31/f24.gz many/d32/f24.gz many/d33/f24.gz many/d34/f24.gz many/d35/f24.gz "
+              "many/d36/f24.gz many/d37/f24.gz many/d38/f24.gz many/d39/f24.gz") == 0,
+       "patterns are expanded in order");
+
+    snprintf(absolute, sizeof(absolute), "%s/a/*.txt", root);
+    snprintf(expected, sizeof(expected), "%s/a/y.txt", root);
+    ok(strcmp(expand(2, 1, paths), expected) == 0, "absolute pattern");
+
+    // Matches same paths in same order as glob(3) in C locale
+    glob_t g;
+    char *many[] = {"many/*/*.log"};
+    size_t n = 0;
+
+    if (glob("many/*/*.log", 0, NULL, &g) != 0) {
+        bail_out("glob() failed");
+    }
+
+    for (unsigned threads = 1; threads <= 16; threads *= 2) {
+        const char *s = expand(threads, 1, many);
+
+        n = 0;
+        for (size_t i = 0; i < g.gl_pathc; i++) {
+            size_t len = strlen(g.gl_pathv[i]);
+
+            good = good && strncmp(s + n, g.gl_pathv[i], len) == 0;
+            n += len + 1;
+        }
+        good = good && n == strlen(s) + 1;
+    }
+    globfree(&g);
+
+    ok(good, "same as glob() with 1 to 16 threads");
+}
+
+static void test_early_destroy(void) {
+    char *patterns[] = {"many/**", "a/**"};
+    struct utils_glob *glob = utils_glob_create(2, patterns, 8);
+    const char *path;
+    int created = glob != NULL;
+
+    ok(utils_glob_next(glob, &path) == 1 && strcmp(path, "many/d00") == 0, "first path");
+    utils_glob_destroy(glob);
+    ok(created, "destroyed before all paths are read");
+}
+
+int main(void) {
+    plan(18);
+
+    make_tree();
+
+    test_patterns();
+    test_order();
+    test_early_destroy();
+
+    tmpdir_remove(root);
+
+    return 0;
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Tests parser generated by optgen from test-optgen.opts.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <flos/utf8.h>
+#include <flos/utils.h>
+
+#include "parse.h"
+#include "tap.h"
+#include "test-optgen-order.opts.c"
+#include "test-optgen.opts.c"
+
+static void run(struct parse_result *r, const char *args, const char *opts) {
+    parse_args(r, args, opts, test_opts_getopt);
+}
+
+static void test_same_as_getopt(void) {
+    static const char *cases[] = {
+        "program -a foo bar",
+        "program -b -a foo bar",
+        "program -ba foo bar",
+        "program -ab -a foo bar",
+        "program -pfoo bar",
+        "program -p foo bar",
+        "program -ab -q baz -pfoo bar",
+        "program -p foo -x -a bar",
+        "program -p foo -: -a bar",
+        "program -ap",
+        "program donald -p billy duck -a bar",
+        "program donald -p billy duck -a -- -b foo -q johnny bar",
+        "program -a- foo",
+        "program one -a two -pthree four -p five six -q",
+        "program one -ab two -p -a three -- four -b",
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        struct parse_result expected, actual;
+
+        run(&expected, cases[i], "abp:q:");
+        run(&actual, cases[i], NULL);
+
+        ok(same_result(&expected, &actual), cases[i]);
+    }
+}
+
+static void test_long_options(void) {
+    struct parse_result r;
+
+    run(&r, "program --all --print=out --verbose op", NULL);
+    ok(r.count == 3 && r.codes[0] == 'a' && r.codes[1] == 'p' && r.codes[2] == TEST_OPTS_OPT_VERBOSE,
+       "long options return option codes");
+    ok(same_string(r.optargs[1], "out"), "--name=value sets optarg");
+    ok(r.argc == 1 && same_string(r.operands[0], "op"), "operand is left");
+
+    run(&r, "program --color always -b", NULL);
+    ok(r.count == 2 && r.codes[0] == TEST_OPTS_OPT_COLOR && same_string(r.optargs[0], "always"),
+       "--name value sets optarg");
+
+    run(&r, "program --colour", NULL);
+    ok(r.count == 1 && r.codes[0] == '?' && same_string(r.optargs[0], "colour"), "unknown long option");
+
+    run(&r, "program --all=yes", NULL);
+    ok(r.count == 1 && r.codes[0] == '?', "argument to long option without one");
+
+    run(&r, "program --print", NULL);
+    ok(r.count == 1 && r.codes[0] == '?' && same_string(r.optargs[0], "print"), "missing long option argument");
+
+    run(&r, "program --al", NULL);
+    ok(r.count == 1 && r.codes[0] == '?', "long option names are not abbreviated");
+
+    run(&r, "program one --color never two --print=x three --print four", NULL);
+    ok(r.count == 3 && same_string(r.optargs[0], "never") && same_string(r.optargs[2], "four") && r.argc == 3 &&
+           same_string(r.operands[0], "one") && same_string(r.operands[1], "two") &&
+           same_string(r.operands[2], "three"),
+       "long option arguments between operands are not moved");
+}
+
+static void test_ordering(void) {
+    static const char *cases[] = {
+        "program donald -p billy duck -a bar",
+        "program donald -a -- -p duck",
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        struct parse_result expected, actual;
+
+        run(&expected, cases[i], "-ap:");
+        parse_args(&actual, cases[i], NULL, test_order_getopt);
+
+        ok(same_result(&expected, &actual), cases[i]);
+    }
+
+    struct parse_result expected, actual;
+
+    setenv("POSIXLY_CORRECT", "1", 1);
+    run(&expected, "program -a donald -p billy", "abp:q:");
+    run(&actual, "program -a donald -p billy", NULL);
+    unsetenv("POSIXLY_CORRECT");
+
+    ok(same_result(&expected, &actual) && actual.count == 1 && actual.argc == 3, "POSIXLY_CORRECT is honoured");
+}
+
+static void test_table(void) {
+    ok(TEST_OPTS_OPTIONS_COUNT == 8 && test_opts_options[5].code == TEST_OPTS_OPT_COLOR, "option count");
+    ok(test_opts_options[2].argument == UTILS_REQUIRED_ARGUMENT && strcmp(test_opts_options[2].arg_name, "FILE") == 0,
+       "option table holds argument placeholders");
+    ok(test_opts_options[4].short_name == '\0' && strcmp(test_opts_options[4].long_name, "verbose") == 0,
+       "long only option has no short name");
+    ok(test_opts_options[6].argument == UTILS_LIST_ARGUMENT &&
+           test_opts_options[7].argument == UTILS_KEY_VALUE_ARGUMENT,
+       "list placeholders make list arguments");
+}
+
+int main(void) {
+    plan(31);
+
+    if (freopen("/dev/null", "w", stderr) == NULL) {
+        bail_out("cannot redirect stderr");
+    }
+
+    test_same_as_getopt();
+    test_long_options();
+    test_ordering();
+    test_table();
+
+    return 0;
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _XOPEN_SOURCE 700 // nftw() of tmpdir.h
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <flos/utf8.h>
+#include <flos/utils.h>
+
+#include "tap.h"
+#include "tmpdir.h"
+
+#define COUNT 1000
+
+static char root[TMPDIR_PATH];
+static char *operands[COUNT];
+
+// Operand i is a file of i bytes, except a missing one and a directory
+static void make_files(void) {
+    tmpdir_enter(root, "test-prefetch");
+
+    for (int i = 0; i < COUNT; i++) {
+        char path[32];
+
+        snprintf(path, sizeof(path), "f%d", i);
+        operands[i] = strdup(path);
+
+        if (i == 7) {
+            continue; // missing
+        }
+        if (i == 8) {
+            mkdir(path, 0755);
+            continue;
+        }
+
+        FILE *f = fopen(path, "w");
+
+        if (f == NULL) {
+            bail_out("cannot create test file");
+        }
+        for (int j = 0; j < i; j++) {
+            fputc('x', f);
+        }
+        fclose(f);
+    }
+}
+
+static int expected(const struct utils_prefetch_result *r) {
+    if (r->index == 7) {
+        return r->error == ENOENT && r->fd < 0;
+    }
+    if (r->index == 8) {
+        return r->error == 0 && S_ISDIR(r->st.st_mode);
+    }
+
+    return r->error == 0 && S_ISREG(r->st.st_mode) && r->st.st_size == (off_t)r->index;
+}
+
+// Takes all operands, checks each is resolved and returned once
+static void check(int flags, unsigned threads, const char *name) {
+    static char seen[COUNT];
+    struct utils_prefetch *prefetch = utils_prefetch_create(COUNT, operands, flags, threads);
+    struct utils_prefetch_result r;
+    size_t n = 0;
+    int good = prefetch != NULL;
+
+    memset(seen, 0, sizeof(seen));
+
+    while (good && utils_prefetch_next(prefetch, &r) == 1) {
+        good = r.index < COUNT && !seen[r.index] && r.path == operands[r.index] && expected(&r);
+        good = good && (!(flags & UTILS_PREFETCH_IN_ORDER) || r.index == n);
+        good = good && (flags & UTILS_PREFETCH_OPEN ? r.fd >= 0 || r.error != 0 : r.fd < 0);
+
+        if (r.fd >= 0) {
+            char buf[8];
+
+            good = good && (r.index == 8 || read(r.fd, buf, sizeof(buf)) == (r.index < 8 ? (ssize_t)r.index : 8));
+            close(r.fd);
+        }
+
+        seen[r.index] = 1;
+        n++;
+    }
+
+    good = good && n == COUNT && utils_prefetch_next(prefetch, &r) == 0;
+    utils_prefetch_destroy(prefetch);
+
+    ok(good, name);
+}
+
+static void test_prefetch(void) {
+    check(0, 0, "stat without threads");
+    check(0, 4, "stat with threads");
+    check(UTILS_PREFETCH_OPEN, 0, "open without threads");
+    check(UTILS_PREFETCH_OPEN, 4, "open with threads");
+    check(UTILS_PREFETCH_IN_ORDER, 4, "stat in order");
+    check(UTILS_PREFETCH_OPEN | UTILS_PREFETCH_IN_ORDER, 8, "open in order");
+}
+
+static void test_limits(void) {
+    struct rlimit old, low;
+    struct utils_prefetch *prefetch;
+    struct utils_prefetch_result r;
+    int fd;
+
+    // Only a window of operands is open at a time
+    getrlimit(RLIMIT_NOFILE, &old);
+    low = old;
+    low.rlim_cur = 64;
+    if (setrlimit(RLIMIT_NOFILE, &low) != 0) {
+        bail_out("cannot lower descriptor limit");
+    }
+    check(UTILS_PREFETCH_OPEN, 1, "more operands than descriptors");
+    setrlimit(RLIMIT_NOFILE, &old);
+
+    // Descriptors not returned are closed
+    fd = dup(0);
+    close(fd);
+
+    prefetch = utils_prefetch_create(COUNT, operands, UTILS_PREFETCH_OPEN, 4);
+    ok(utils_prefetch_next(prefetch, &r) == 1 && r.fd >= 0, "first operand is ready");
+    close(r.fd);
+    utils_prefetch_destroy(prefetch);
+
+    ok(dup(0) == fd, "destroy closes descriptors");
+
+    prefetch = utils_prefetch_create(0, operands, 0, 2);
+    ok(prefetch != NULL && utils_prefetch_next(prefetch, &r) == 0, "no operands");
+    utils_prefetch_destroy(prefetch);
+}
+
+int main(void) {
+    plan(10);
+
+    make_files();
+
+    test_prefetch();
+    test_limits();
+
+    tmpdir_remove(root);
+
+    return 0;
+}
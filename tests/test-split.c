@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <flos/utf8.h>
+#include <flos/utils.h>
+
+#include "tap.h"
+
+#define LARGE 100000
+
+static char joined[4096];
+
+// Joins items with '|' to compare them as one string
+static const char *split(const char *value, const char *separators, char escape) {
+    struct utils_splitter s;
+    struct utils_span item;
+    size_t n = 0;
+
+    joined[0] = '\0';
+    utils_split_init(&s, value, separators, escape);
+    while (utils_split_next(&s, &item)) {
+        n += snprintf(joined + n, sizeof(joined) - n, "%s%.*s", n ? "|" : "", (int)item.len, item.ptr);
+    }
+
+    return joined;
+}
+
+static void test_split(void) {
+    ok(strcmp(split("a,b,c", ",", '\0'), "a|b|c") == 0, "items are split");
+    ok(strcmp(split(",a,,b,", ",", '\0'), "a|b") == 0, "empty items are skipped");
+    ok(strcmp(split("", ",", '\0'), "") == 0, "empty value has no items");
+    ok(strcmp(split("a,b;c d", ",; ", '\0'), "a|b|c|d") == 0, "any of separators");
+    ok(strcmp(split("a\\,b,c\\\\,d\\", ",", '\\'), "a\\,b|c\\\\|d\\") == 0, "escaped separators are kept");
+    ok(strcmp(split("a1b2c3d4e5f6g7h8i9j", "123456789", '\0'), "a|b|c|d|e|f|g|h|i|j") == 0,
+       "more separators than scanned at once");
+    ok(strcmp(split("one two", ",", '\0'), "one two") == 0, "value without separators");
+}
+
+static void test_pair(void) {
+    struct utils_span item = {"key=value=x", 11}, key, value;
+
+    ok(utils_split_pair(item, '=', '\0', &key, &value) && key.len == 3 && memcmp(key.ptr, "key", 3) == 0 &&
+           value.len == 7 && memcmp(value.ptr, "value=x", 7) == 0,
+       "pair is split at first assign");
+
+    item.ptr = "a\\=b=c";
+    item.len = 6;
+    ok(utils_split_pair(item, '=', '\\', &key, &value) && key.len == 4 && value.len == 1 && *value.ptr == 'c',
+       "escaped assign is part of key");
+
+    item.ptr = "flag";
+    item.len = 4;
+    ok(!utils_split_pair(item, '=', '\\', &key, &value) && key.len == 4 && value.len == 0, "item without assign");
+}
+
+static void test_unescape(void) {
+    char out[16];
+    struct utils_span span = {"a\\,b\\\\c\\", 8};
+
+    ok(utils_unescape(span, '\\', out) == 6 && strcmp(out, "a,b\\c\\") == 0, "escapes are removed");
+}
+
+// Items of a large value are views into it, at every offset of scanned blocks
+static void test_large(void) {
+    char *value = malloc(LARGE + 1);
+    char *copy = malloc(LARGE + 1);
+    struct utils_splitter s;
+    struct utils_span item;
+    size_t count = 0, expected = 0;
+    int good = 1;
+
+    for (size_t i = 0; i < LARGE; i++) {
+        value[i] = (char)(i % 37 == 0 || i % 101 == 0 ? ',' : 'a' + i % 26);
+    }
+    value[LARGE] = '\0';
+    memcpy(copy, value, LARGE + 1);
+
+    for (char *t = strtok(copy, ","); t != NULL; t = strtok(NULL, ",")) {
+        expected++;
+    }
+    memcpy(copy, value, LARGE + 1);
+
+    utils_split_init(&s, value, ",", '\\');
+    for (char *t = strtok(copy, ","); utils_split_next(&s, &item); t = strtok(NULL, ",")) {
+        good = good && t != NULL && item.ptr == value + (t - copy) && item.len == strlen(t);
+        count++;
+    }
+
+    ok(good && count == expected, "same items as strtok()");
+
+    for (size_t i = 0; i < LARGE; i++) {
+        good = good && value[i] == (char)(i % 37 == 0 || i % 101 == 0 ? ',' : 'a' + i % 26);
+    }
+    ok(good, "value is not modified");
+
+    free(value);
+    free(copy);
+}
+
+int main(void) {
+    plan(13);
+
+    test_split();
+    test_pair();
+    test_unescape();
+    test_large();
+
+    return 0;
+}
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <flos/utf8.h>
+#include <flos/utils.h>
+
+#include "parse.h"
+#include "tap.h"
+
+#define MAX_WORDS 16
+#define LARGE     200000
+
+static const char *const cases[][MAX_WORDS] = {
+    {"prog", NULL},
+    {"prog", "-a", "-b", "x", NULL},
+    {"prog", "in", "-a", "out", "-bfoo", "last", NULL},
+    {"prog", "-ac", "-abval", "-cb", "arg", NULL},
+    {"prog", "-x", "-ax", "-a-", "-a=", NULL},
+    {"prog", "-a", "--", "-b", "x", "--", NULL},
+    {"prog", "file", "-", "--name", "--a", "-c", NULL},
+    {"prog", "one", "two", "-b", NULL},
+    {"prog", "-b", NULL},
+    {"prog", "-ab", NULL},
+    {"prog", "-", "-", "op", "-a", "--", NULL},
+    {"prog", "-:", "-?", "-9", "op", "-cab", "v", NULL},
+};
+
+static const char *const all_opts[] = {"ab:c", "+ab:c", "-ab:c", ":ab:c", "+:ab:c", "-:ab:c"};
+
+// Parses copy of argv with utils_getopt() and compares with result
+static int same_as_getopt(int argc, char *const argv[], const char *opts, const struct utils_parse *parse) {
+    struct parse_result r;
+
+    copy_words(&r.words, argc, argv);
+    parse_words(&r, opts, NULL);
+
+    return same_parse(&r, parse);
+}
+
+static int count_words(const char *const words[]) {
+    int argc = 0;
+
+    while (words[argc] != NULL) {
+        argc++;
+    }
+
+    return argc;
+}
+
+// Parses each case in every mode with the given budget
+static int run_cases(size_t max_units, int random) {
+    int good = 1;
+
+    for (size_t o = 0; o < sizeof(all_opts) / sizeof(all_opts[0]); o++) {
+        for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); k++) {
+            char *const *argv = (char *const *)cases[k];
+            int argc = count_words(cases[k]);
+            struct utils_parser *parser = utils_parser_create(argc, argv, all_opts[o]);
+            struct utils_budget budget = {max_units, 0};
+            enum utils_step step;
+
+            while ((step = utils_parser_step(parser, &budget)) == UTILS_STEP_MORE) {
+                good = good && utils_parser_result(parser) == NULL;
+                if (random) {
+                    budget.max_units = 1 + rand() % 5;
+                }
+            }
+
+            good = good && step == UTILS_STEP_DONE &&
+                   same_as_getopt(argc, argv, all_opts[o], utils_parser_result(parser));
+            utils_parser_destroy(parser);
+        }
+    }
+
+    return good;
+}
+
+static void test_cases(void) {
+    ok(run_cases(0, 0), "result without limit is same as utils_getopt()");
+    ok(run_cases(1, 0), "result of single unit steps is same as utils_getopt()");
+    ok(run_cases(1, 1), "result of random steps is same as utils_getopt()");
+
+    setenv("POSIXLY_CORRECT", "1", 1);
+    ok(run_cases(2, 0), "POSIXLY_CORRECT stops at first operand");
+    unsetenv("POSIXLY_CORRECT");
+}
+
+static void test_empty(void) {
+    char *argv[] = {NULL};
+    struct utils_parser *parser = utils_parser_create(0, argv, "a");
+    const struct utils_parse *parse;
+
+    ok(utils_parser_step(parser, NULL) == UTILS_STEP_DONE && (parse = utils_parser_result(parser)) != NULL &&
+           parse->noptions == 0 && parse->noperands == 0,
+       "empty argv has empty result");
+    utils_parser_destroy(parser);
+}
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static size_t large_options, large_operands, large_units;
+
+// Operands scattered among options and clusters, as the worst case of utils_getopt() was
+static char **make_large(void) {
+    char **argv = malloc((LARGE + 1) * sizeof(*argv));
+
+    argv[0] = "prog";
+    for (int i = 1; i < LARGE; i++) {
+        argv[i] = i % 3 == 0 ? "file" : i % 3 == 1 ? "-ac" : "-bval";
+        large_options += i % 3 == 0 ? 0 : i % 3 == 1 ? 2 : 1;
+        large_operands += i % 3 == 0;
+        large_units += i % 3 == 1 ? 2 : 1; // a word, and next character of cluster
+    }
+    argv[LARGE] = NULL;
+
+    large_units += 1 + large_options + 1; // end of argv, options copied, end of options
+
+    return argv;
+}
+
+static void test_large(void) {
+    char **argv = make_large();
+    struct utils_parser *parser = utils_parser_create(LARGE, argv, "ab:c");
+    struct utils_budget budget = {1000, 0};
+    const struct utils_parse *parse;
+    size_t steps = 0;
+    double longest = 0;
+    enum utils_step step;
+    int good = 1;
+
+    while ((step = utils_parser_step(parser, &budget)) == UTILS_STEP_MORE) {
+        steps++;
+    }
+    steps++;
+
+    parse = utils_parser_result(parser);
+    ok(step == UTILS_STEP_DONE && parse != NULL && parse->noptions == large_options &&
+           parse->noperands == large_operands,
+       "large argv is parsed");
+    ok(steps == (large_units + 999) / 1000, "steps are bounded by units");
+
+    for (size_t i = 0; i < parse->noperands; i++) {
+        good = good && parse->operands[i] == argv[3 * (i + 1)];
+    }
+    for (int i = 1; i < LARGE; i++) {
+        good = good && strcmp(argv[i], i % 3 == 0 ? "file" : i % 3 == 1 ? "-ac" : "-bval") == 0;
+    }
+    ok(good, "operands point into argv, which is not modified");
+    utils_parser_destroy(parser);
+
+    parser = utils_parser_create(LARGE, argv, "ab:c");
+    budget.max_units = 0;
+    budget.max_nanoseconds = 100000;
+    steps = 0;
+
+    do {
+        double start = now(), took;
+
+        step = utils_parser_step(parser, &budget);
+        if ((took = now() - start) > longest) {
+            longest = took;
+        }
+        steps++;
+    } while (step == UTILS_STEP_MORE);
+
+    printf("# %zu steps of at most %.0f us\n", steps, longest * 1e6);
+    ok(step == UTILS_STEP_DONE && steps > 1, "steps are bounded by time");
+    utils_parser_destroy(parser);
+
+    free(argv);
+}
+
+int main(void) {
+    plan(9);
+
+    if (freopen("/dev/null", "w", stderr) == NULL) {
+        bail_out("cannot redirect stderr");
+    }
+
+    unsetenv("POSIXLY_CORRECT");
+    srand(1);
+
+    test_cases();
+    test_empty();
+    test_large();
+
+    return 0;
+}
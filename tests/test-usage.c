@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <flos/utf8.h>
+#include <flos/utils.h>
+
+#include "tap.h"
+
+static const struct utils_option options[] = {
+    {'a', 'a', "all", UTILS_NO_ARGUMENT, NULL, "Show all entries"},
+    {'q', 'q', NULL, UTILS_REQUIRED_ARGUMENT, "QUERY", "Run QUERY"},
+    {0x102, '\0', "color", UTILS_REQUIRED_ARGUMENT, "WHEN", "Colorize the output; WHEN can be always, never or auto"},
+    {0x103, '\0', "a-very-long-option-name", UTILS_REQUIRED_ARGUMENT, "VALUE", "Long names go first"},
+    {'v', 'v', NULL, UTILS_NO_ARGUMENT, NULL, NULL},
+};
+
+static char output[4096];
+
+static const char *render(const char *synopsis, size_t width) {
+    int fds[2];
+    ssize_t n;
+
+    if (pipe(fds) != 0) {
+        bail_out("pipe failed");
+    }
+
+    if (utils_usage(fds[1], synopsis, options, sizeof(options) / sizeof(options[0]), width) != 0) {
+        bail_out("utils_usage failed");
+    }
+    close(fds[1]);
+
+    n = read(fds[0], output, sizeof(output) - 1);
+    output[n > 0 ? n : 0] = '\0';
+    close(fds[0]);
+
+    return output;
+}
+
+int main(void) {
+    plan(3);
+
+    ok(strcmp(render("prog [OPTIONS] FILE...", 0),
+              "Usage: prog [OPTIONS] FILE...\n"
+              "\n"
+              "  -a, --all         Show all entries\n"
+              "  -q QUERY          Run QUERY\n"
+              "      --color=WHEN  Colorize the output; WHEN can be always, never or auto\n"
+              "      --a-very-long-option-name=VALUE\n"
+              "                    Long names go first\n"
+              "  -v\n") == 0,
+       "usage with default width");
+
+    ok(strcmp(render(NULL, 50),
+              "  -a, --all         Show all entries\n"
+              "  -q QUERY          Run QUERY\n"
+              "      --color=WHEN  Colorize the output; WHEN can\n"
+              "                    be always, never or auto\n"
+              "      --a-very-long-option-name=VALUE\n"
+              "                    Long names go first\n"
+              "  -v\n") == 0,
+       "descriptions are wrapped");
+
+    ok(utils_usage(-1, "prog", options, 1, 0) == -1, "write error is reported");
+
+    return 0;
+}
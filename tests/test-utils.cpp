@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Tests C++ interface in flos/utils.hpp against utils_getopt().
+ */
+
+#include <cstdio>
+#include <string_view>
+
+#include <flos/utils.hpp>
+
+#include "parse.h"
+#include "tap.h"
+
+constexpr flos::options spec{"abp:q:"};
+constexpr flos::options ordered{"+:ab:"};
+
+static_assert(spec.has('a') && spec.has('q') && !spec.has('x') && !spec.has(':'));
+static_assert(spec.takes_argument('p') && !spec.takes_argument('b'));
+static_assert(spec.ordering() == '\0' && !spec.silent());
+static_assert(ordered.ordering() == '+' && ordered.silent() && ordered.takes_argument('b'));
+static_assert(spec.table().kinds['p'] == UTILS_OPT_ARGUMENT && spec.table().kinds['a'] == UTILS_OPT_FLAG);
+
+template <std::size_t N> static bool rejects(const char (&s)[N]) {
+    try {
+        flos::options<N> o(s);
+        (void)o;
+    } catch (const std::invalid_argument &) {
+        return true;
+    }
+    return false;
+}
+
+static void test_spec() {
+    ok(rejects("aba"), "duplicate option is rejected");
+    ok(rejects("a::"), "optional argument is rejected");
+    ok(rejects("a:b:::"), "repeated ':' is rejected");
+    ok(rejects("+::a"), "':' without option is rejected");
+    ok(rejects("a-b"), "non alphanumeric option is rejected");
+    ok(!rejects("-:a:b"), "valid spec is accepted");
+}
+
+// Runs both interfaces over same arguments and compares results
+template <std::size_t N> static bool same_as_getopt(const flos::options<N> &opts, const char *args) {
+    parse_result expected, actual;
+    utf8_char c;
+
+    parse_args(&expected, args, opts.c_str(), nullptr);
+
+    split_words(&actual.words, args);
+    flos::parser p(opts, actual.words.argc, actual.words.argv);
+
+    for (actual.count = 0; actual.count < PARSE_MAX_WORDS && (c = p.next()) != 0; actual.count++) {
+        actual.codes[actual.count] = c;
+        actual.optargs[actual.count] = p.value().data();
+    }
+
+    actual.argc = static_cast<int>(p.operand_count());
+    for (int i = 0; i < actual.argc; i++) {
+        actual.operands[i] = p.operand(i).data();
+    }
+
+    return same_result(&expected, &actual);
+}
+
+static void test_parser() {
+    static const char *cases[] = {
+        "program -a foo bar",
+        "program -ba foo bar",
+        "program -pfoo bar",
+        "program -ab -q baz -pfoo bar",
+        "program -p foo -x -a bar",
+        "program -ap",
+        "program donald -p billy duck -a bar",
+        "program donald -p billy duck -a -- -b foo -q johnny bar",
+    };
+
+    for (const char *args : cases) {
+        ok(same_as_getopt(spec, args), args);
+    }
+
+    ok(same_as_getopt(ordered, "program -a foo -b bar -x -b"), "table keeps '+' ordering");
+    ok(same_as_getopt(ordered, "program -a -x -b"), "table keeps silent diagnostics");
+
+    char a[] = "prog", b[] = "-pvalue", c[] = "file";
+    char *argv[] = {a, b, c, nullptr};
+    flos::parser p(spec, 3, argv);
+
+    ok(p.next() == 'p' && p.value() == "value" && p.value().data() == b + 2, "value is a view into argv");
+    ok(p.next() == 0 && p.operand_count() == 1 && p.operand(0) == "file", "operands are left");
+}
+
+int main() {
+    plan(18);
+
+    if (std::freopen("/dev/null", "w", stderr) == nullptr) {
+        bail_out("cannot redirect stderr");
+    }
+
+    test_spec();
+    test_parser();
+
+    return 0;
+}
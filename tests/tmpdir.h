@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Temporary directory tests create their files in. Needs _XOPEN_SOURCE 500
+ * or later for nftw(), defined before any include.
+ */
+
+#ifndef TMPDIR_H
+#define TMPDIR_H
+
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "tap.h"
+
+#define TMPDIR_PATH 64
+
+// Creates directory /tmp/NAME-XXXXXX, writing its path to root, and makes it current
+static inline void tmpdir_enter(char root[TMPDIR_PATH], const char *name) {
+    snprintf(root, TMPDIR_PATH, "/tmp/%s-XXXXXX", name);
+
+    if (mkdtemp(root) == NULL || chdir(root) != 0) {
+        bail_out("cannot create test directory");
+    }
+}
+
+static inline int tmpdir_remove_entry(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    (void)st;
+    (void)ftw;
+
+    return type == FTW_DP ? rmdir(path) : unlink(path);
+}
+
+// Removes root and everything below it, without following symbolic links
+static inline void tmpdir_remove(const char *root) {
+    if (nftw(root, tmpdir_remove_entry, 16, FTW_DEPTH | FTW_PHYS) != 0) {
+        diag("cannot remove test directory");
+    }
+}
+
+#endif /* TMPDIR_H */
@@ -0,0 +1,715 @@
+/*
+ * Copyright (C) 2024 Armands Arseniuss Skolmeisters <arseniuss@arseniuss.id.lv>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * optgen - generates specialized option parser from an option spec.
+ *
+ * Usage: optgen [-o FILE.c] [-H FILE.h] SPEC
+ *
+ * Spec is a line based text file. Empty lines and lines starting with '#' are
+ * ignored. Lines starting with '%' are directives:
+ *
+ *     %prefix NAME   prefix of generated symbols (default: spec file basename)
+ *     %silent        do not print diagnostics (like leading ':' in opts)
+ *     %mode +        stop at the first operand (like leading '+' in opts)
+ *     %mode -        return operands in order as 1 (like leading '-' in opts)
+ *
+ * Every other line describes one option:
+ *
+ *     SHORT LONG ARG HELP...
+ *
+ * where SHORT is a single letter or digit or '-', LONG is a long option name or '-'
+ * and ARG is '-' for options without an argument or argument placeholder
+ * (e.g. FILE) for options with a required argument. Placeholder ending with
+ * ",..." marks a list (e.g. DIR,...) and one also containing '=' a list of
+ * pairs (e.g. KEY=VALUE,...), see utils_split_next(). Options without a short
+ * name are returned as codes starting from 0x100.
+ *
+ * Generated source contains constant option table, switch based matchers and
+ * PREFIX_getopt() function with the same semantics as utils_getopt(), except
+ * for long options: utils_getopt() knows no long names and returns every
+ * "--name" as 2, while PREFIX_getopt() returns the code of the option named,
+ * its argument taken from "--name=value" or the next word, or '?' when there
+ * is none. Operands are permuted with utils_permute().
+ */
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <flos/utils.h>
+
+#define LONG_CODE_BASE 0x100
+
+struct spec_option {
+    char short_name;
+    char *long_name;
+    char *arg_name;
+    char *help;
+    long code;
+};
+
+static const char *spec_name;
+static int spec_line;
+
+static struct spec_option *options;
+static size_t options_count;
+
+static char *prefix;
+static int silent;
+static char mode; // '+', '-' or '\0' to permute operands
+
+static void die(const char *fmt, ...) {
+    va_list ap;
+
+    if (spec_line > 0) {
+        fprintf(stderr, "optgen: %s:%d: ", spec_name, spec_line);
+    } else {
+        fprintf(stderr, "optgen: ");
+    }
+
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+
+    fputc('\n', stderr);
+    exit(1);
+}
+
+static char *xstrdup(const char *s) {
+    char *d = strdup(s);
+
+    if (d == NULL) {
+        die("out of memory");
+    }
+
+    return d;
+}
+
+static char *next_field(char **p) {
+    char *s = *p;
+
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+
+    if (*s == '\0') {
+        return NULL;
+    }
+
+    char *start = s;
+
+    while (*s != '\0' && *s != ' ' && *s != '\t') {
+        s++;
+    }
+
+    if (*s != '\0') {
+        *s++ = '\0';
+    }
+
+    *p = s;
+
+    return start;
+}
+
+static char *make_prefix(const char *path) {
+    const char *base = strrchr(path, '/');
+    char *p = xstrdup(base ? base + 1 : path);
+    char *dot = strchr(p, '.');
+
+    if (dot != NULL) {
+        *dot = '\0';
+    }
+
+    for (char *c = p; *c; c++) {
+        if (!isalnum((unsigned char)*c)) {
+            *c = '_';
+        }
+    }
+
+    return p;
+}
+
+// Letters and digits only, as any other character cannot follow another one in a cluster and '?' is an error code
+static int is_short_name(int c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+}
+
+static int is_identifier(const char *s) {
+    if (!isalpha((unsigned char)*s) && *s != '_') {
+        return 0;
+    }
+
+    while (*s) {
+        if (!isalnum((unsigned char)*s) && *s != '_') {
+            return 0;
+        }
+        s++;
+    }
+
+    return 1;
+}
+
+static void add_option(char *line) {
+    char *sh = next_field(&line);
+    char *lo = next_field(&line);
+    char *arg = next_field(&line);
+
+    if (sh == NULL || lo == NULL || arg == NULL) {
+        die("expected SHORT LONG ARG HELP");
+    }
+
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+
+    struct spec_option o = {0};
+
+    if (strcmp(sh, "-") != 0) {
+        if (sh[1] != '\0' || !is_short_name(sh[0])) {
+            die("invalid short option '%s'", sh);
+        }
+        o.short_name = sh[0];
+    }
+
+    if (strcmp(lo, "-") != 0) {
+        for (char *c = lo; *c; c++) {
+            if (!isalnum((unsigned char)*c) && *c != '-' && *c != '_') {
+                die("invalid long option '%s'", lo);
+            }
+        }
+        o.long_name = xstrdup(lo);
+    }
+
+    if (o.short_name == '\0' && o.long_name == NULL) {
+        die("option has neither short nor long name");
+    }
+
+    for (size_t i = 0; i < options_count; i++) {
+        if (o.short_name && options[i].short_name == o.short_name) {
+            die("duplicate short option '%c'", o.short_name);
+        }
+        if (o.long_name && options[i].long_name && strcmp(options[i].long_name, o.long_name) == 0) {
+            die("duplicate long option '%s'", o.long_name);
+        }
+    }
+
+    o.arg_name = strcmp(arg, "-") != 0 ? xstrdup(arg) : NULL;
+    o.help = xstrdup(line);
+    o.code = o.short_name ? (unsigned char)o.short_name : LONG_CODE_BASE + (long)options_count;
+
+    struct spec_option *n = realloc(options, (options_count + 1) * sizeof(*options));
+
+    if (n == NULL) {
+        die("out of memory");
+    }
+
+    options = n;
+    options[options_count++] = o;
+}
+
+static void read_spec(const char *path) {
+    FILE *f = fopen(path, "r");
+
+    if (f == NULL) {
+        die("cannot open %s", path);
+    }
+
+    spec_name = path;
+
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+
+    while ((len = getline(&line, &cap, f)) != -1) {
+        spec_line++;
+
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = '\0';
+        }
+
+        char *p = line;
+
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+
+        if (*p == '\0' || *p == '#') {
+            continue;
+        }
+
+        if (*p == '%') {
+            char *name = next_field(&p);
+            char *value = next_field(&p);
+
+            if (strcmp(name, "%prefix") == 0) {
+                if (value == NULL || !is_identifier(value)) {
+                    die("%%prefix requires an identifier");
+                }
+                prefix = xstrdup(value);
+            } else if (strcmp(name, "%silent") == 0) {
+                silent = 1;
+            } else if (strcmp(name, "%mode") == 0) {
+                if (value == NULL || (strcmp(value, "+") != 0 && strcmp(value, "-") != 0)) {
+                    die("%%mode requires '+' or '-'");
+                }
+                mode = value[0];
+            } else {
+                die("unknown directive %s", name);
+            }
+            continue;
+        }
+
+        add_option(p);
+    }
+
+    free(line);
+    fclose(f);
+
+    spec_line = 0;
+
+    if (options_count == 0) {
+        die("%s: no options defined", path);
+    }
+}
+
+static void emit_string(FILE *out, const char *s) {
+    if (s == NULL) {
+        fputs("NULL", out);
+        return;
+    }
+
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', out);
+        }
+        fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+static void emit_char(FILE *out, char c) {
+    if (c == '\'' || c == '\\') {
+        fprintf(out, "'\\%c'", c);
+    } else {
+        fprintf(out, "'%c'", c);
+    }
+}
+
+// Handling of operands for each %mode, pasted in place of "@OPERAND@".
+static const char operand_permute[] = "        if (getenv(\"POSIXLY_CORRECT\") != NULL) {\n"
+                                      "            goto finished;\n"
+                                      "        }\n"
+                                      "\n"
+                                      "        *argc -= utils_permute(*argc, *argv, @P@_options,\n"
+                                      "                               sizeof(@P@_options) / sizeof(@P@_options[0]));\n"
+                                      "\n"
+                                      "        if (*argc == 0) {\n"
+                                      "            goto finished;\n"
+                                      "        }\n"
+                                      "\n"
+                                      "        goto start;\n";
+static const char operand_require[] = "        goto finished;\n";
+static const char operand_return[] = "        *optarg = argp;\n"
+                                     "\n"
+                                     "        return 1;\n";
+
+// Writes text replacing "@P@" with symbol prefix, "@SILENT@" with silent flag, "@START@" with
+// operand loop label and "@OPERAND@" with operand handling.
+static void emit_template(FILE *out, const char *text) {
+    while (*text) {
+        if (strncmp(text, "@P@", 3) == 0) {
+            fputs(prefix, out);
+            text += 3;
+        } else if (strncmp(text, "@START@", 7) == 0) {
+            fputs(mode == '\0' ? "start:\n" : "", out); // only permuting parser loops over operands
+            text += 7;
+        } else if (strncmp(text, "@OPERAND@", 9) == 0) {
+            emit_template(out, mode == '+' ? operand_require : mode == '-' ? operand_return : operand_permute);
+            text += 9;
+        } else if (strncmp(text, "@SILENT@", 8) == 0) {
+            fputc(silent ? '1' : '0', out);
+            text += 8;
+        } else {
+            fputc(*text++, out);
+        }
+    }
+}
+
+static void emit_header(FILE *out, const char *guard) {
+    fprintf(out, "/* Generated by optgen from %s; do not edit. */\n\n", spec_name);
+    fprintf(out, "#ifndef %s\n#define %s\n\n#include <flos/utils.h>\n\n", guard, guard);
+
+    for (size_t i = 0; i < options_count; i++) {
+        fprintf(out, "#define ");
+        for (const char *c = prefix; *c; c++) {
+            fputc(toupper((unsigned char)*c), out);
+        }
+        fprintf(out, "_OPT_");
+        if (options[i].long_name) {
+            for (const char *c = options[i].long_name; *c; c++) {
+                fputc(*c == '-' ? '_' : toupper((unsigned char)*c), out);
+            }
+        } else {
+            fputc(options[i].short_name, out);
+        }
+        fprintf(out, " 0x%lx\n", options[i].code);
+    }
+
+    fprintf(out, "\n#define ");
+    for (const char *c = prefix; *c; c++) {
+        fputc(toupper((unsigned char)*c), out);
+    }
+    fprintf(out, "_OPTIONS_COUNT %zu\n\n", options_count);
+
+    emit_template(out, "extern const struct utils_option @P@_options[];\n\n"
+                       "/*\n"
+                       " * Same as utils_getopt() with the options of the spec, except that long\n"
+                       " * options are matched by name: \"--name=value\" and \"--name value\" return\n"
+                       " * the option code with value as optarg, where utils_getopt() returns 2.\n"
+                       " */\n"
+                       "utf8_char @P@_getopt(int *argc, char **argv[], char **optarg);\n\n");
+
+    fprintf(out, "#endif /* %s */\n", guard);
+}
+
+static int compare_long(const void *a, const void *b) {
+    const struct spec_option *oa = *(const struct spec_option *const *)a;
+    const struct spec_option *ob = *(const struct spec_option *const *)b;
+    size_t la = strlen(oa->long_name), lb = strlen(ob->long_name);
+
+    if (la != lb) {
+        return la < lb ? -1 : 1;
+    }
+
+    return strcmp(oa->long_name, ob->long_name);
+}
+
+static void emit_match_short(FILE *out) {
+    emit_template(out, "static inline int @P@_match_short(int c) {\n    switch (c) {\n");
+
+    for (size_t i = 0; i < options_count; i++) {
+        if (options[i].short_name) {
+            fprintf(out, "    case ");
+            emit_char(out, options[i].short_name);
+            fprintf(out, ":\n        return %zu;\n", i);
+        }
+    }
+
+    fprintf(out, "    default:\n        return -1;\n    }\n}\n\n");
+}
+
+// Long names are dispatched by length and first character, so only one memcmp() is needed.
+static void emit_match_long(FILE *out) {
+    const struct spec_option **sorted = calloc(options_count, sizeof(*sorted));
+    size_t n = 0;
+
+    if (sorted == NULL) {
+        die("out of memory");
+    }
+
+    for (size_t i = 0; i < options_count; i++) {
+        if (options[i].long_name) {
+            sorted[n++] = &options[i];
+        }
+    }
+
+    qsort(sorted, n, sizeof(*sorted), compare_long);
+
+    emit_template(out, "static inline int @P@_match_long(const char *name, size_t len) {\n    switch (len) {\n");
+
+    for (size_t i = 0; i < n;) {
+        size_t len = strlen(sorted[i]->long_name);
+
+        fprintf(out, "    case %zu:\n        switch (name[0]) {\n", len);
+
+        while (i < n && strlen(sorted[i]->long_name) == len) {
+            char first = sorted[i]->long_name[0];
+
+            fprintf(out, "        case ");
+            emit_char(out, first);
+            fprintf(out, ":\n");
+
+            while (i < n && strlen(sorted[i]->long_name) == len && sorted[i]->long_name[0] == first) {
+                fprintf(out, "            if (memcmp(name, ");
+                emit_string(out, sorted[i]->long_name);
+                fprintf(out, ", %zu) == 0) {\n                return %td;\n            }\n", len,
+                        sorted[i] - options);
+                i++;
+            }
+
+            fprintf(out, "            break;\n");
+        }
+
+        fprintf(out, "        }\n        break;\n");
+    }
+
+    fprintf(out, "    }\n\n    return -1;\n}\n\n");
+
+    free(sorted);
+}
+
+static const char parser_template[] =
+    "utf8_char @P@_getopt(int *argc, char **argv[], char **optarg) {\n"
+    "    const int silent = @SILENT@;\n"
+    "    char *argp;\n"
+    "    int i;\n"
+    "\n"
+    "    if (*argc <= 0 || argv == NULL || *argv == NULL || **argv == NULL || optarg == NULL) {\n"
+    "        goto finished;\n"
+    "    }\n"
+    "\n"
+    "    *optarg = NULL;\n"
+    "\n"
+    "    (*argv)++;\n"
+    "    (*argc)--;\n"
+    "\n"
+    "    if (*argc == 0 || **argv == NULL) {\n"
+    "        goto finished;\n"
+    "    }\n"
+    "\n"
+    "@START@"
+    "    argp = **argv;\n"
+    "\n"
+    "    if (argp[0] != '-') {\n"
+    "@OPERAND@"
+    "    }\n"
+    "\n"
+    "    if (argp[1] == '-') {\n"
+    "        char *name = argp + 2;\n"
+    "\n"
+    "        if (*name == '\\0') { // words after it are operands, moved already when permuting\n"
+    "            (*argv)++;\n"
+    "            (*argc)--;\n"
+    "            goto finished;\n"
+    "        }\n"
+    "\n"
+    "        char *value = strchr(name, '=');\n"
+    "        size_t len = value != NULL ? (size_t)(value - name) : strlen(name);\n"
+    "\n"
+    "        if ((i = @P@_match_long(name, len)) < 0) {\n"
+    "            if (!silent) {\n"
+    "                fprintf(stderr, \"Unknown option: --%.*s\\n\", (int)len, name);\n"
+    "            }\n"
+    "            *optarg = name;\n"
+    "            return '?';\n"
+    "        }\n"
+    "\n"
+    "        if (@P@_options[i].argument == UTILS_NO_ARGUMENT) {\n"
+    "            if (value != NULL) {\n"
+    "                if (!silent) {\n"
+    "                    fprintf(stderr, \"Option --%.*s doesn't allow an argument.\\n\", (int)len, name);\n"
+    "                }\n"
+    "                *optarg = name;\n"
+    "                return '?';\n"
+    "            }\n"
+    "        } else if (value != NULL) {\n"
+    "            *optarg = value + 1;\n"
+    "        } else {\n"
+    "            (*argv)++;\n"
+    "            (*argc)--;\n"
+    "\n"
+    "            if (*argc == 0 || (*optarg = **argv) == NULL) {\n"
+    "                if (!silent) {\n"
+    "                    fprintf(stderr, \"Option --%s requires an argument.\\n\", name);\n"
+    "                }\n"
+    "                *optarg = name;\n"
+    "                return silent ? ':' : '?';\n"
+    "            }\n"
+    "        }\n"
+    "\n"
+    "        return @P@_options[i].code;\n"
+    "    }\n"
+    "\n"
+    "    if (argp[1] == '\\0') { // a single '-'\n"
+    "        return -1;\n"
+    "    }\n"
+    "\n"
+    "    argp++;\n"
+    "\n"
+    "    if ((i = @P@_match_short((unsigned char)*argp)) < 0) {\n"
+    "        *optarg = argp;\n"
+    "        if (!silent) {\n"
+    "            fprintf(stderr, \"Unknown option: -%c\\n\", *argp);\n"
+    "        }\n"
+    "        return '?';\n"
+    "    }\n"
+    "\n"
+    "    if (@P@_options[i].argument != UTILS_NO_ARGUMENT) {\n"
+    "        if (*(argp + 1) != '\\0') {\n"
+    "            *optarg = argp + 1;\n"
+    "        } else {\n"
+    "            (*argv)++;\n"
+    "            (*argc)--;\n"
+    "\n"
+    "            if (*argc == 0 || (*optarg = **argv) == NULL) {\n"
+    "                if (!silent) {\n"
+    "                    fprintf(stderr, \"Option -%c requires an argument.\\n\", *argp);\n"
+    "                }\n"
+    "                *optarg = argp;\n"
+    "                return silent ? ':' : '?';\n"
+    "            }\n"
+    "        }\n"
+    "    } else if (*(argp + 1) != '\\0') {\n"
+    "        if (!isalnum((unsigned char)*(argp + 1))) {\n"
+    "            if (!silent) {\n"
+    "                fprintf(stderr, \"Option -%c doesn't allow an argument.\\n\", *argp);\n"
+    "            }\n"
+    "            return '?';\n"
+    "        }\n"
+    "\n"
+    "        *argp = '-';\n"
+    "        **argv = argp; // scan here again next round\n"
+    "        (*argv)--;\n"
+    "        (*argc)++;\n"
+    "    }\n"
+    "\n"
+    "    return @P@_options[i].code;\n"
+    "\n"
+    "finished:\n"
+    "    while ((*argv)[*argc] != NULL) {\n"
+    "        (*argc)++;\n"
+    "    }\n"
+    "\n"
+    "    return 0;\n"
+    "}\n";
+
+static const char *argument_kind(const char *arg_name) {
+    size_t len = arg_name != NULL ? strlen(arg_name) : 0;
+
+    if (arg_name == NULL) {
+        return "UTILS_NO_ARGUMENT";
+    }
+    if (len < 4 || strcmp(arg_name + len - 4, ",...") != 0) {
+        return "UTILS_REQUIRED_ARGUMENT";
+    }
+
+    return strchr(arg_name, '=') != NULL ? "UTILS_KEY_VALUE_ARGUMENT" : "UTILS_LIST_ARGUMENT";
+}
+
+static void emit_source(FILE *out, const char *header) {
+    fprintf(out, "/* Generated by optgen from %s; do not edit. */\n\n", spec_name);
+    fprintf(out, "#include <ctype.h>\n#include <stdio.h>\n#include <stdlib.h>\n#include <string.h>\n\n");
+    fprintf(out, "#include <flos/utils.h>\n\n");
+
+    if (header != NULL) {
+        const char *base = strrchr(header, '/');
+        fprintf(out, "#include \"%s\"\n\n", base ? base + 1 : header);
+    }
+
+    emit_template(out, "const struct utils_option @P@_options[] = {\n");
+
+    for (size_t i = 0; i < options_count; i++) {
+        const struct spec_option *o = &options[i];
+
+        fprintf(out, "    {0x%lx, ", o->code);
+        if (o->short_name) {
+            emit_char(out, o->short_name);
+        } else {
+            fputs("'\\0'", out);
+        }
+        fputs(", ", out);
+        emit_string(out, o->long_name);
+        fprintf(out, ", %s, ", argument_kind(o->arg_name));
+        emit_string(out, o->arg_name);
+        fputs(", ", out);
+        emit_string(out, o->help);
+        fputs("},\n", out);
+    }
+
+    fprintf(out, "};\n\n");
+
+    emit_match_short(out);
+    emit_match_long(out);
+    emit_template(out, parser_template);
+}
+
+static FILE *open_output(const char *path) {
+    if (path == NULL) {
+        return stdout;
+    }
+
+    FILE *f = fopen(path, "w");
+
+    if (f == NULL) {
+        die("cannot create %s", path);
+    }
+
+    return f;
+}
+
+static void close_output(FILE *f, const char *path) {
+    if (ferror(f) || (f != stdout && fclose(f) != 0)) {
+        die("cannot write %s", path ? path : "standard output");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *source_path = NULL;
+    const char *header_path = NULL;
+    char *optarg;
+    utf8_char c;
+
+    while ((c = utils_getopt(&argc, &argv, &optarg, "o:H:"))) {
+        switch (c) {
+        case 'o':
+            source_path = optarg;
+            break;
+        case 'H':
+            header_path = optarg;
+            break;
+        default:
+            fprintf(stderr, "Usage: optgen [-o FILE.c] [-H FILE.h] SPEC\n");
+            return 1;
+        }
+    }
+
+    if (argc != 1) {
+        fprintf(stderr, "Usage: optgen [-o FILE.c] [-H FILE.h] SPEC\n");
+        return 1;
+    }
+
+    read_spec(argv[0]);
+
+    if (prefix == NULL) {
+        prefix = make_prefix(argv[0]);
+    }
+
+    if (header_path != NULL) {
+        const char *base = strrchr(header_path, '/');
+        char *guard = xstrdup(base ? base + 1 : header_path);
+        FILE *h = open_output(header_path);
+
+        for (char *g = guard; *g; g++) {
+            *g = isalnum((unsigned char)*g) ? toupper((unsigned char)*g) : '_';
+        }
+
+        emit_header(h, guard);
+        close_output(h, header_path);
+        free(guard);
+    }
+
+    FILE *out = open_output(source_path);
+
+    emit_source(out, header_path);
+    close_output(out, source_path);
+
+    return 0;
+}